@@ -1,7 +1,13 @@
 #include "dictionary.h"
+#include "dictionary_image.h"
+#include "dictionary_private.h"
+#include "dictionary_stats.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
 
 static int default_error_callback(const char *format, ...)
 {
@@ -23,210 +29,1466 @@ void dictionary_set_error_callback(int (*errback)(const char *, ...))
   }
 }
 
+#ifdef DICTIONARY_STATS
+_Thread_local struct dictionary_stats dictionary_tls_stats;
+void (*dictionary_trace_begin)(const char *, const void *);
+void (*dictionary_trace_end)(const char *, const void *);
+#endif
+
+int dictionary_stats_get(struct dictionary_stats *out)
+{
+#ifdef DICTIONARY_STATS
+  if (!out)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return -1;
+  }
+  *out = dictionary_tls_stats;
+  return 0;
+#else
+  (void)out;
+  return -1;
+#endif
+}
+
+void dictionary_stats_reset(void)
+{
+#ifdef DICTIONARY_STATS
+  memset(&dictionary_tls_stats, 0, sizeof(dictionary_tls_stats));
+#endif
+}
+
+void dictionary_set_trace_hooks(void (*begin)(const char *, const void *),
+                                void (*end)(const char *, const void *))
+{
+#ifdef DICTIONARY_STATS
+  dictionary_trace_begin = begin;
+  dictionary_trace_end = end;
+#else
+  (void)begin;
+  (void)end;
+#endif
+}
+
+static unsigned long dictionary_generation_seq;
+
+/* Record a change of shape: generations are never reused, even across
+ * dictionaries, so (d, generation) identifies one layout of one table. */
+static void dictionary_touch(struct dictionary *d)
+{
+  d->generation =
+      __atomic_add_fetch(&dictionary_generation_seq, 1, __ATOMIC_RELAXED);
+}
+
+/* ini::hash() in iniparser.hpp computes this at compile time; keep the two
+ * in step. */
 unsigned dictionary_hash(const char *key)
 {
 
-  unsigned int hash = 0;
-  unsigned int len = strlen(key);
-  for (unsigned int i = 0; i < len; i++)
+  unsigned int hash = 0;
+  unsigned int len = strlen(key);
+  for (unsigned int i = 0; i < len; i++)
+  {
+    hash += (unsigned)key[i];
+    hash += (hash << 10);
+    hash ^= (hash >> 6);
+  }
+
+  hash += (hash << 3);
+  hash ^= (hash >> 11);
+  hash += (hash << 15);
+
+  return hash;
+}
+
+struct dict_pool_str {
+  struct dict_pool_str *next;
+  unsigned int refs;
+  unsigned int hash;
+  char str[];
+};
+
+struct dict_pool {
+  unsigned int count;
+  unsigned int size;
+  struct dict_pool_str **table;
+};
+
+#define POOLMINSZ 64
+
+static struct dict_pool *pool_new(void)
+{
+  DICT_STAT(allocs);
+  struct dict_pool *p = malloc(sizeof(struct dict_pool));
+  if (!p)
+  {
+    return NULL;
+  }
+  DICT_STAT(allocs);
+  p->table = calloc(POOLMINSZ, sizeof(struct dict_pool_str *));
+  if (!p->table)
+  {
+    free(p);
+    return NULL;
+  }
+  p->size = POOLMINSZ;
+  p->count = 0;
+  return p;
+}
+
+static void pool_del(struct dict_pool *p)
+{
+  for (unsigned int i = 0; i < p->size; i++)
+  {
+    struct dict_pool_str *curr = p->table[i];
+    while (curr)
+    {
+      struct dict_pool_str *next = curr->next;
+      free(curr);
+      curr = next;
+    }
+  }
+  free(p->table);
+  free(p);
+}
+
+static int pool_grow(struct dict_pool *p)
+{
+  DICT_STAT(allocs);
+  struct dict_pool_str **new_table =
+      calloc(p->size * 2, sizeof(struct dict_pool_str *));
+  if (!new_table)
+  {
+    return -1;
+  }
+  for (unsigned int i = 0; i < p->size; i++)
+  {
+    struct dict_pool_str *curr = p->table[i];
+    while (curr)
+    {
+      struct dict_pool_str *next = curr->next;
+      unsigned int index = curr->hash % (p->size * 2);
+      curr->next = new_table[index];
+      new_table[index] = curr;
+      curr = next;
+    }
+  }
+  free(p->table);
+  p->table = new_table;
+  p->size *= 2;
+  return 0;
+}
+
+/* Return the pooled copy of s with its reference count bumped. */
+static char *pool_intern(struct dict_pool *p, const char *s)
+{
+  unsigned int hash = dictionary_hash(s);
+  struct dict_pool_str *curr = p->table[hash % p->size];
+  while (curr)
+  {
+    if (curr->hash == hash && strcmp(curr->str, s) == 0)
+    {
+      curr->refs++;
+      return curr->str;
+    }
+    curr = curr->next;
+  }
+
+  if (p->count >= p->size * 0.7 && pool_grow(p) != 0)
+  {
+    return NULL;
+  }
+
+  size_t len = strlen(s) + 1;
+  DICT_STAT(allocs);
+  struct dict_pool_str *ps = malloc(sizeof(struct dict_pool_str) + len);
+  if (!ps)
+  {
+    return NULL;
+  }
+  memcpy(ps->str, s, len);
+  ps->refs = 1;
+  ps->hash = hash;
+  ps->next = p->table[hash % p->size];
+  p->table[hash % p->size] = ps;
+  p->count++;
+  return ps->str;
+}
+
+static void pool_release(struct dict_pool *p, char *s)
+{
+  struct dict_pool_str *ps =
+      (struct dict_pool_str *)(s - offsetof(struct dict_pool_str, str));
+  if (--ps->refs > 0)
+  {
+    return;
+  }
+
+  struct dict_pool_str **link = &p->table[ps->hash % p->size];
+  while (*link != ps)
+  {
+    link = &(*link)->next;
+  }
+  *link = ps->next;
+  p->count--;
+  free(ps);
+}
+
+static char *bucket_store(char *buf, size_t bufsz, const char *s)
+{
+  size_t len = strlen(s) + 1;
+  if (len <= bufsz)
+  {
+    memcpy(buf, s, len);
+    return buf;
+  }
+  DICT_STAT(allocs);
+  char *t = malloc(len);
+  if (t)
+  {
+    memcpy(t, s, len);
+  }
+  return t;
+}
+
+static void bucket_init_value(struct bucket *b)
+{
+  b->value = NULL;
+  b->vbuf = b->val_buf;
+  b->vcap = sizeof(b->val_buf);
+  b->flags = 0;
+  b->ctag = BUCKET_CACHE_EMPTY;
+}
+
+static void bucket_release_interned(struct dictionary *d, struct bucket *b)
+{
+  if (b->flags & BUCKET_VAL_INTERNED)
+  {
+    pool_release(d->pool, b->value);
+    b->flags &= ~BUCKET_VAL_INTERNED;
+    b->value = NULL;
+  }
+}
+
+static void bucket_free(struct dictionary *d, struct bucket *b)
+{
+  bucket_release_interned(d, b);
+  if (b->key != b->key_buf && !(b->flags & BUCKET_KEY_BORROWED))
+  {
+    free(b->key);
+  }
+  if (b->vbuf != b->val_buf)
+  {
+    free(b->vbuf);
+  }
+  if (!(b->flags & BUCKET_IN_CHUNK))
+  {
+    free(b);
+  }
+}
+
+/* Overwrite in place when the new value fits the current buffer, otherwise
+ * grow it geometrically. On failure the old value is left untouched. */
+static int bucket_set_value(struct dictionary *d, struct bucket *b,
+                            const char *val)
+{
+  b->ctag = BUCKET_CACHE_EMPTY;
+  if (val && d->intern)
+  {
+    char *s = pool_intern(d->pool, val);
+    if (!s)
+    {
+      return -1;
+    }
+    bucket_release_interned(d, b);
+    b->value = s;
+    b->flags |= BUCKET_VAL_INTERNED;
+    return 0;
+  }
+
+  bucket_release_interned(d, b);
+  if (!val)
+  {
+    b->value = NULL;
+    return 0;
+  }
+
+  size_t len = strlen(val) + 1;
+  if (len > b->vcap)
+  {
+    size_t cap = b->vcap * 2 > len ? b->vcap * 2 : len;
+    DICT_STAT(allocs);
+    char *buf = malloc(cap);
+    if (!buf)
+    {
+      return -1;
+    }
+    if (b->vbuf != b->val_buf)
+    {
+      free(b->vbuf);
+    }
+    b->vbuf = buf;
+    b->vcap = cap;
+  }
+  memcpy(b->vbuf, val, len);
+  b->value = b->vbuf;
+  return 0;
+}
+
+static struct bucket *table_lookup(const struct dictionary *d, const char *key,
+                                   unsigned int hash)
+{
+  struct bucket *curr = d->table[hash % d->size];
+  while (curr)
+  {
+    DICT_STAT(probes);
+    if (curr->hash == hash && (DICT_STAT(strcmps), strcmp(curr->key, key) == 0))
+    {
+      return curr;
+    }
+    curr = curr->next;
+  }
+  return NULL;
+}
+
+/* Overlays: the layers under the overlay's own table, top first */
+struct dict_layers
+{
+  size_t n;
+  const struct dictionary *d[];
+};
+
+static const char layer_missing[1];
+
+/* Looks key up in layers [from, to) of overlay d, top down */
+static int layers_get(const struct dictionary *d, size_t from, size_t to,
+                      const char *key, unsigned int hash, const char **val)
+{
+  for (size_t i = from; i < to; i++)
+  {
+    const struct dictionary *l = d->layers->d[i];
+    if (l->image)
+    {
+      const char *v = dict_image_get(l->image, key, hash, layer_missing);
+      if (v != layer_missing)
+      {
+        *val = v;
+        return 1;
+      }
+      continue;
+    }
+    struct bucket *b = table_lookup(l, key, hash);
+    if (b)
+    {
+      *val = b->value;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static const char *overlay_get(const struct dictionary *d, const char *key,
+                               unsigned int hash, const char *def)
+{
+  const char *val;
+  struct bucket *b = table_lookup(d, key, hash);
+  if (b ? !(b->flags & BUCKET_TOMBSTONE)
+        : layers_get(d, 0, d->layers->n, key, hash, &val))
+  {
+    DICT_STAT(get_hits);
+    return b ? b->value : val;
+  }
+  DICT_STAT(get_misses);
+  return def;
+}
+
+/* Copy-on-write clones. Cloning moves the table of a dictionary, with
+ * everything its buckets point to, into a dict_shared that the source and
+ * the clone both read through. A chain of either is then a private prefix
+ * followed by a suffix of the shared chain of the same slot: a write copies
+ * the prefix up to the bucket it changes, never a shared bucket itself, and
+ * the first write copies the slot array. Growing the table makes every
+ * bucket private again. */
+struct dict_shared
+{
+  int refs;
+  unsigned int size;
+  struct bucket **table;
+  struct dict_shared *parent; /* buckets shared at an earlier clone */
+  struct dict_pool *pool;
+  struct dict_chunk *chunks;
+  struct dict_hold *holds;
+};
+
+static void chunks_free(struct dict_chunk *c)
+{
+  while (c)
+  {
+    struct dict_chunk *next = c->next;
+    free(c);
+    c = next;
+  }
+}
+
+static void holds_release(struct dict_hold *h)
+{
+  while (h)
+  {
+    struct dict_hold *next = h->next;
+    h->release(h->obj);
+    free(h);
+    h = next;
+  }
+}
+
+static int chain_contains(const struct bucket *chain, const struct bucket *b)
+{
+  for (; chain; chain = chain->next)
+  {
+    if (chain == b)
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Frees the private prefix of a chain, up to its first bucket in shared */
+static void chain_free(struct dictionary *d, struct bucket *b,
+                       const struct bucket *shared)
+{
+  while (b && !chain_contains(shared, b))
+  {
+    struct bucket *next = b->next;
+    bucket_free(d, b);
+    b = next;
+  }
+}
+
+static void shared_unref(struct dict_shared *s)
+{
+  while (s && __atomic_sub_fetch(&s->refs, 1, __ATOMIC_ACQ_REL) == 0)
+  {
+    struct dict_shared *parent = s->parent;
+    for (unsigned int i = 0; i < s->size; i++)
+    {
+      struct bucket *b = s->table[i];
+      while (b && !(parent && chain_contains(parent->table[i], b)))
+      {
+        struct bucket *next = b->next;
+        /* The pool goes as a whole below */
+        b->flags &= ~BUCKET_VAL_INTERNED;
+        bucket_free(NULL, b);
+        b = next;
+      }
+    }
+    free(s->table);
+    if (s->pool)
+    {
+      pool_del(s->pool);
+    }
+    chunks_free(s->chunks);
+    holds_release(s->holds);
+    free(s);
+    s = parent;
+  }
+}
+
+static int bucket_is_shared(const struct dictionary *d, unsigned int i,
+                            const struct bucket *b)
+{
+  return d->shared && chain_contains(d->shared->table[i], b);
+}
+
+/* The first write after a clone copies the slot array */
+static int table_unshare(struct dictionary *d)
+{
+  if (!d->shared || d->table != d->shared->table)
+  {
+    return 0;
+  }
+  DICT_STAT(allocs);
+  struct bucket **table = malloc(d->size * sizeof(struct bucket *));
+  if (!table)
+  {
+    return -1;
+  }
+  memcpy(table, d->table, d->size * sizeof(struct bucket *));
+  d->table = table;
+  return 0;
+}
+
+/* A private copy of shared bucket b, linked to the same successor */
+static struct bucket *bucket_unshare(struct dictionary *d,
+                                     const struct bucket *b)
+{
+  DICT_STAT(allocs);
+  struct bucket *c = malloc(sizeof(struct bucket));
+  if (!c)
+  {
+    return NULL;
+  }
+  c->key = bucket_store(c->key_buf, sizeof(c->key_buf), b->key);
+  if (!c->key)
+  {
+    free(c);
+    return NULL;
+  }
+  c->hash = b->hash;
+  bucket_init_value(c);
+  if (bucket_set_value(d, c, b->value) != 0)
+  {
+    bucket_free(d, c);
+    return NULL;
+  }
+  c->flags |= b->flags & BUCKET_TOMBSTONE;
+  c->next = b->next;
+  return c;
+}
+
+/* Makes the chain of slot i private before target (the whole chain for
+ * NULL) and returns the link to target, or NULL when out of memory. */
+static struct bucket **chain_unshare(struct dictionary *d, unsigned int i,
+                                     const struct bucket *target)
+{
+  if (table_unshare(d) != 0)
+  {
+    return NULL;
+  }
+  struct bucket **link = &d->table[i];
+  while (*link != target)
+  {
+    if (bucket_is_shared(d, i, *link))
+    {
+      struct bucket *c = bucket_unshare(d, *link);
+      if (!c)
+      {
+        return NULL;
+      }
+      *link = c;
+    }
+    link = &(*link)->next;
+  }
+  dictionary_touch(d);
+  return link;
+}
+
+/* Replaces shared bucket b, in slot i of d, with a private copy */
+static struct bucket *bucket_own(struct dictionary *d, unsigned int i,
+                                 struct bucket *b)
+{
+  struct bucket **link = chain_unshare(d, i, b);
+  struct bucket *c = link ? bucket_unshare(d, b) : NULL;
+  if (!c)
+  {
+    return NULL;
+  }
+  *link = c;
+  return c;
+}
+
+/* Before the table is rebuilt: no bucket can stay shared */
+static int dictionary_unshare(struct dictionary *d)
+{
+  if (!d->shared)
+  {
+    return 0;
+  }
+  for (unsigned int i = 0; i < d->size; i++)
+  {
+    if (!chain_unshare(d, i, NULL))
+    {
+      return -1;
+    }
+  }
+  shared_unref(d->shared);
+  d->shared = NULL;
+  return 0;
+}
+
+/* Rehashes every bucket into a table of size slots */
+static int dictionary_grow(struct dictionary *d, unsigned int size)
+{
+  if (dictionary_unshare(d) != 0)
+  {
+    error_callback("%s: malloc() failed\n", __func__);
+    return -1;
+  }
+
+  DICT_TRACE_BEGIN(__func__, d);
+  DICT_STAT(grows);
+  DICT_STAT(allocs);
+  struct bucket **new_table = calloc(size, sizeof(struct bucket *));
+  if (!new_table)
+  {
+    error_callback("%s: calloc() failed\n", __func__);
+    DICT_TRACE_END(__func__, d);
+    return -1;
+  }
+
+  for (unsigned int i = 0; i < d->size; i++)
+  {
+    struct bucket *current = d->table[i];
+    while (current)
+    {
+      unsigned int new_index = current->hash % size;
+      struct bucket *tmp = current->next;
+      current->next = new_table[new_index];
+      new_table[new_index] = current;
+      current = tmp;
+    }
+  }
+
+  free(d->table);
+  d->size = size;
+  d->table = new_table;
+  dictionary_touch(d);
+
+  DICT_TRACE_END(__func__, d);
+  return 0;
+}
+
+/** Minimal allocated number of entries in a dictionary */
+#define DICTMINSZ 128
+struct dictionary *dictionary_new(size_t size)
+{
+  /* If no size was specified, allocate space for DICTMINSZ */
+  if (size < DICTMINSZ)
+  {
+    size = DICTMINSZ;
+  }
+
+  return dictionary_new_sized(size);
+}
+
+/* Exactly `size` slots, for callers that bring a prebuilt hash index */
+struct dictionary *dictionary_new_sized(unsigned int size)
+{
+  if (size == 0)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return NULL;
+  }
+
+  DICT_STAT(allocs);
+  struct dictionary *d = malloc(sizeof(struct dictionary));
+  if (!d)
+  {
+    error_callback("%s: malloc() failed\n", __func__);
+    return NULL;
+  }
+
+  DICT_STAT(allocs);
+  d->table = calloc(size, sizeof(struct bucket *));
+  if (!d->table)
+  {
+    error_callback("%s: calloc() failed\n", __func__);
+    free(d);
+    return NULL;
+  }
+
+  d->size = size;
+  d->numOfElements = 0;
+  d->intern = 0;
+  d->pool = NULL;
+  d->chunks = NULL;
+  d->holds = NULL;
+  d->watch = NULL;
+  d->shared = NULL;
+  d->layers = NULL;
+  d->image = NULL;
+  d->maplen = 0;
+  dictionary_touch(d);
+
+  return d;
+}
+
+struct dictionary *dictionary_overlay(struct dictionary *const *layers,
+                                      size_t n)
+{
+  if (!layers && n)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return NULL;
+  }
+  for (size_t i = 0; i < n; i++)
+  {
+    if (!layers[i] || layers[i]->layers)
+    {
+      error_callback("%s: invalid layer\n", __func__);
+      return NULL;
+    }
+  }
+
+  struct dictionary *d = dictionary_new(0);
+  if (!d)
+  {
+    return NULL;
+  }
+  DICT_STAT(allocs);
+  d->layers = malloc(sizeof(struct dict_layers) +
+                     n * sizeof(const struct dictionary *));
+  if (!d->layers)
+  {
+    error_callback("%s: malloc() failed\n", __func__);
+    dictionary_del(d);
+    return NULL;
+  }
+  d->layers->n = n;
+  for (size_t i = 0; i < n; i++)
+  {
+    d->layers->d[i] = layers[n - 1 - i];
+  }
+  return d;
+}
+
+void *dictionary_chunk_alloc(struct dictionary *d, size_t size)
+{
+  DICT_STAT(allocs);
+  struct dict_chunk *c = malloc(sizeof(struct dict_chunk) + size);
+  if (!c)
+  {
+    error_callback("%s: malloc() failed\n", __func__);
+    return NULL;
+  }
+  c->size = size;
+  c->next = d->chunks;
+  d->chunks = c;
+  return c + 1;
+}
+
+void dictionary_del(struct dictionary *d)
+{
+  if (!d)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return;
+  }
+
+  if (d->image)
+  {
+    dict_image_unmap(d->image, d->maplen);
+    free(d);
+    return;
+  }
+
+  for (unsigned i = 0; i < d->size; i++)
+  {
+    chain_free(d, d->table[i], d->shared ? d->shared->table[i] : NULL);
+  }
+
+  if (d->pool)
+  {
+    pool_del(d->pool);
+  }
+  chunks_free(d->chunks);
+  if (d->watch)
+  {
+    dict_watch_free(d->watch);
+  }
+  holds_release(d->holds);
+  if (!d->shared || d->table != d->shared->table)
+  {
+    free(d->table);
+  }
+  shared_unref(d->shared);
+  free(d->layers);
+  free(d);
+}
+
+const char *dictionary_get(const struct dictionary *d, const char *key,
+                           const char *def)
+{
+  if (!d || !key)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return def;
+  }
+
+  if (d->image)
+  {
+    return dict_image_get(d->image, key, dictionary_hash(key), def);
+  }
+  if (d->layers)
+  {
+    return overlay_get(d, key, dictionary_hash(key), def);
+  }
+
+  struct bucket *b = dictionary_find(d, key);
+  return b ? b->value : def;
+}
+
+const char *dictionary_get_hashed(const struct dictionary *d, const char *key,
+                                  unsigned hash, const char *def)
+{
+  if (!d || !key)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return def;
+  }
+
+  if (d->image)
+  {
+    return dict_image_get(d->image, key, hash, def);
+  }
+  if (d->layers)
+  {
+    return overlay_get(d, key, hash, def);
+  }
+
+  struct bucket *b = dictionary_find_hashed(d, key, hash);
+  return b ? b->value : def;
+}
+
+struct bucket *dictionary_find(const struct dictionary *d, const char *key)
+{
+  return dictionary_find_hashed(d, key, dictionary_hash(key));
+}
+
+struct bucket *dictionary_find_hashed(const struct dictionary *d,
+                                      const char *key, unsigned int hash)
+{
+  if (d->image || d->layers)
+  {
+    return NULL;
+  }
+
+  struct bucket *b = table_lookup(d, key, hash);
+  if (b)
+  {
+    DICT_STAT(get_hits);
+  }
+  else
+  {
+    DICT_STAT(get_misses);
+  }
+  return b;
+}
+
+int bucket_cache_load(const struct bucket *b, unsigned char tag,
+                      uint64_t *bits)
+{
+  if (__atomic_load_n(&b->ctag, __ATOMIC_ACQUIRE) != tag)
+  {
+    return -1;
+  }
+  *bits = __atomic_load_n(&b->cbits, __ATOMIC_RELAXED);
+  return 0;
+}
+
+void bucket_cache_store(struct bucket *b, unsigned char tag, uint64_t bits)
+{
+  unsigned char empty = BUCKET_CACHE_EMPTY;
+  /* First conversion wins; readers racing on another type just don't cache */
+  if (!__atomic_compare_exchange_n(&b->ctag, &empty, BUCKET_CACHE_BUSY, 0,
+                                   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+  {
+    return;
+  }
+  __atomic_store_n(&b->cbits, bits, __ATOMIC_RELAXED);
+  __atomic_store_n(&b->ctag, tag, __ATOMIC_RELEASE);
+}
+
+static int value_equal(const char *a, const char *b)
+{
+  return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+/* Stores val in b, by pointer when borrowed */
+static int bucket_assign(struct dictionary *d, struct bucket *b,
+                         const char *val, int borrow)
+{
+  if (!borrow)
+  {
+    return bucket_set_value(d, b, val);
+  }
+  bucket_release_interned(d, b);
+  b->ctag = BUCKET_CACHE_EMPTY;
+  b->value = (char *)val;
+  return 0;
+}
+
+/* Sets the value of curr, the existing bucket of key */
+static int bucket_update(struct dictionary *d, struct bucket *curr,
+                         const char *key, const char *val, int borrow)
+{
+  int revived = curr->flags & BUCKET_TOMBSTONE;
+  int changed = d->watch && (revived || !value_equal(curr->value, val));
+  if (bucket_is_shared(d, curr->hash % d->size, curr))
+  {
+    curr = bucket_own(d, curr->hash % d->size, curr);
+    if (!curr)
+    {
+      return -1;
+    }
+  }
+  if (bucket_assign(d, curr, val, borrow) != 0)
+  {
+    return -1;
+  }
+  if (revived)
+  {
+    curr->flags &= ~BUCKET_TOMBSTONE;
+    dictionary_touch(d);
+  }
+  if (changed)
+  {
+    dict_watch_changed(d, key);
+  }
+  return 0;
+}
+
+static int dictionary_insert(struct dictionary *d, const char *key,
+                             const char *val, int borrow, const char *func)
+{
+  if (!d || !key)
+  {
+    error_callback("%s: invalid input\n", func);
+    return -1;
+  }
+
+  if (d->image)
+  {
+    error_callback("%s: read-only dictionary\n", func);
+    return -1;
+  }
+
+  unsigned int hash = dictionary_hash(key);
+  struct bucket *curr = table_lookup(d, key, hash);
+  if (curr)
+  {
+    if (bucket_update(d, curr, key, val, borrow) != 0)
+    {
+      error_callback("%s: malloc() failed\n", func);
+      return -1;
+    }
+    return 0;
+  }
+
+  if (d->numOfElements >= d->size * 0.7)
+  {
+    if (dictionary_grow(d, d->size * 2) != 0)
+    {
+      error_callback("%s: dictionary_grow() failed\n", func);
+      return -1;
+    }
+  }
+  unsigned int index = hash % d->size;
+  if (table_unshare(d) != 0)
+  {
+    error_callback("%s: malloc() failed\n", func);
+    return -1;
+  }
+
+  DICT_STAT(allocs);
+  struct bucket *new_bucket = malloc(sizeof(struct bucket));
+  if (!new_bucket)
+  {
+    error_callback("%s: malloc() failed\n", func);
+    return -1;
+  }
+
+  if (borrow)
+  {
+    new_bucket->key = (char *)key;
+  }
+  else
+  {
+    new_bucket->key = bucket_store(new_bucket->key_buf,
+                                   sizeof(new_bucket->key_buf), key);
+  }
+  if (!new_bucket->key)
+  {
+    error_callback("%s: malloc() failed\n", func);
+    free(new_bucket);
+    return -1;
+  }
+
+  new_bucket->hash = hash;
+  bucket_init_value(new_bucket);
+  if (borrow)
+  {
+    new_bucket->flags |= BUCKET_KEY_BORROWED;
+  }
+  if (bucket_assign(d, new_bucket, val, borrow) != 0)
+  {
+    error_callback("%s: malloc() failed\n", func);
+    bucket_free(d, new_bucket);
+    return -1;
+  }
+
+  new_bucket->next = d->table[index];
+  d->table[index] = new_bucket;
+  d->numOfElements++;
+  dictionary_touch(d);
+  /* Over a layer holding the same value, nothing visible changed */
+  const char *below;
+  if (d->watch && !(d->layers &&
+                    layers_get(d, 0, d->layers->n, key, hash, &below) &&
+                    value_equal(below, val)))
+  {
+    dict_watch_changed(d, key);
+  }
+
+  return 0;
+}
+
+int dictionary_set(struct dictionary *d, const char *key, const char *val)
+{
+  return dictionary_insert(d, key, val, 0, __func__);
+}
+
+int dictionary_set_borrowed(struct dictionary *d, const char *key,
+                            const char *val)
+{
+  return dictionary_insert(d, key, val, 1, __func__);
+}
+
+int dictionary_hold(struct dictionary *d, void (*release)(void *obj),
+                    void *obj)
+{
+  if (!d || !release || d->image)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return -1;
+  }
+
+  DICT_STAT(allocs);
+  struct dict_hold *h = malloc(sizeof(struct dict_hold));
+  if (!h)
+  {
+    error_callback("%s: malloc() failed\n", __func__);
+    return -1;
+  }
+  h->release = release;
+  h->obj = obj;
+  h->next = d->holds;
+  d->holds = h;
+  return 0;
+}
+
+/* A pair of a bulk insert. Pairs are applied sorted by slot, then in the
+ * order given, so each chain is walked while it is hot. */
+struct bulk_entry
+{
+  const char *key;
+  const char *val;
+  unsigned int hash;
+  unsigned int slot;
+  size_t idx;
+  struct bucket *b;
+};
+
+static int bulk_entry_cmp(const void *a, const void *b)
+{
+  const struct bulk_entry *x = a;
+  const struct bulk_entry *y = b;
+  if (x->slot != y->slot)
   {
-    hash += (unsigned)key[i];
-    hash += (hash << 10);
-    hash ^= (hash >> 6);
+    return x->slot < y->slot ? -1 : 1;
   }
-
-  hash += (hash << 3);
-  hash ^= (hash >> 11);
-  hash += (hash << 15);
-
-  return hash;
+  return x->idx < y->idx ? -1 : x->idx > y->idx;
 }
 
-static int dictionary_grow(struct dictionary *d)
+/* Inserts n pairs whose key and hash are set: the table is sized once, and
+ * the new buckets, with the keys too long to fit in them, come from a single
+ * chunk. With keep, keys already in d are left alone. */
+static int bulk_insert(struct dictionary *d, struct bulk_entry *e, size_t n,
+                       int keep, const char *func)
 {
-  struct bucket **new_table = calloc(d->size * 2, sizeof(struct bucket *));
-  if (!new_table)
+  if (n > UINT_MAX - d->numOfElements)
   {
-    error_callback("%s: calloc() failed\n", __func__);
+    error_callback("%s: too many entries\n", func);
     return -1;
   }
-
-  for (unsigned int i = 0; i < d->size; i++)
+  unsigned int need = d->numOfElements + (unsigned int)n;
+  unsigned int size = d->size;
+  while (need > size * 0.7)
   {
-    struct bucket *current = d->table[i];
-    while (current)
+    if (size > UINT_MAX / 2)
     {
-      unsigned int new_index = dictionary_hash(current->key) % (d->size * 2);
-      struct bucket *tmp = current->next;
-      current->next = new_table[new_index];
-      new_table[new_index] = current;
-      current = tmp;
+      error_callback("%s: too many entries\n", func);
+      return -1;
     }
+    size *= 2;
+  }
+  if (size != d->size && dictionary_grow(d, size) != 0)
+  {
+    error_callback("%s: dictionary_grow() failed\n", func);
+    return -1;
   }
 
-  free(d->table);
-  d->size *= 2;
-  d->table = new_table;
-
-  return 0;
-}
-
-/** Minimal allocated number of entries in a dictionary */
-#define DICTMINSZ 128
-struct dictionary *dictionary_new(size_t size)
-{
-  struct dictionary *d = malloc(sizeof(struct dictionary));
-  if (!d)
+  for (size_t i = 0; i < n; i++)
   {
-    error_callback("%s: malloc() failed\n", __func__);
-    return NULL;
+    e[i].slot = e[i].hash % d->size;
+    e[i].idx = i;
   }
+  qsort(e, n, sizeof(*e), bulk_entry_cmp);
 
-  /* If no size was specified, allocate space for DICTMINSZ */
-  if (size < DICTMINSZ)
+  size_t fresh = 0;
+  size_t keybytes = 0;
+  for (size_t i = 0; i < n; i++)
   {
-    size = DICTMINSZ;
+    e[i].b = table_lookup(d, e[i].key, e[i].hash);
+    if (!e[i].b)
+    {
+      size_t len = strlen(e[i].key) + 1;
+      keybytes += len > DICT_INLINE_KEY ? len : 0;
+      fresh++;
+    }
   }
 
-  d->table = calloc(size, sizeof(struct bucket *));
-  if (!d->table)
+  struct bucket *next = NULL;
+  char *kbuf = NULL;
+  if (fresh)
   {
-    error_callback("%s: calloc() failed\n", __func__);
-    free(d);
-    return NULL;
+    if (table_unshare(d) != 0)
+    {
+      error_callback("%s: malloc() failed\n", func);
+      return -1;
+    }
+    next = dictionary_chunk_alloc(d, fresh * sizeof(struct bucket) + keybytes);
+    if (!next)
+    {
+      return -1;
+    }
+    kbuf = (char *)(next + fresh);
   }
 
-  d->size = size;
-  d->numOfElements = 0;
+  if (d->watch)
+  {
+    dictionary_batch_begin(d);
+  }
+  int ret = 0;
+  unsigned int added = 0;
+  size_t last_slot = SIZE_MAX;
+  for (size_t i = 0; i < n && ret == 0; i++)
+  {
+    struct bucket *b = e[i].b;
+    /* Missing before, but added since if the key is given twice. In a
+     * clone, an update copies the shared buckets chained before the one it
+     * changes, so one found up front may have been replaced since. */
+    if ((!b && last_slot == e[i].slot) || (b && d->shared))
+    {
+      b = table_lookup(d, e[i].key, e[i].hash);
+    }
+    if (b)
+    {
+      if (!keep && bucket_update(d, b, e[i].key, e[i].val, 0) != 0)
+      {
+        error_callback("%s: malloc() failed\n", func);
+        ret = -1;
+      }
+      continue;
+    }
 
-  return d;
+    b = next++;
+    size_t len = strlen(e[i].key) + 1;
+    bucket_init_value(b);
+    b->flags = BUCKET_IN_CHUNK;
+    if (len > sizeof(b->key_buf))
+    {
+      b->key = memcpy(kbuf, e[i].key, len);
+      b->flags |= BUCKET_KEY_BORROWED;
+      kbuf += len;
+    }
+    else
+    {
+      b->key = memcpy(b->key_buf, e[i].key, len);
+    }
+    b->hash = e[i].hash;
+    if (bucket_set_value(d, b, e[i].val) != 0)
+    {
+      error_callback("%s: malloc() failed\n", func);
+      bucket_free(d, b);
+      ret = -1;
+      break;
+    }
+    b->next = d->table[e[i].slot];
+    d->table[e[i].slot] = b;
+    d->numOfElements++;
+    added++;
+    last_slot = e[i].slot;
+    if (d->watch)
+    {
+      dict_watch_changed(d, e[i].key);
+    }
+  }
+  if (added)
+  {
+    dictionary_touch(d);
+  }
+  if (d->watch)
+  {
+    dictionary_batch_end(d);
+  }
+  return ret;
 }
 
-void dictionary_del(struct dictionary *d)
+int dictionary_set_many(struct dictionary *d, const char *const *keys,
+                        const char *const *vals, size_t n)
 {
-  if (!d)
+  if (!d || (n && !keys))
   {
     error_callback("%s: invalid input\n", __func__);
-    return;
+    return -1;
   }
 
-  for (unsigned i = 0; i < d->size; i++)
+  if (d->image)
   {
-    struct bucket *curr = d->table[i];
-    while (curr)
+    error_callback("%s: read-only dictionary\n", __func__);
+    return -1;
+  }
+
+  for (size_t i = 0; i < n; i++)
+  {
+    if (!keys[i])
     {
-      struct bucket *prev = curr;
-      curr = curr->next;
-      free(prev->key);
-      free(prev->value);
-      free(prev);
+      error_callback("%s: invalid input\n", __func__);
+      return -1;
     }
   }
-
-  free(d->table);
-  free(d);
-}
-
-const char *dictionary_get(const struct dictionary *d, const char *key,
-                           const char *def)
-{
-  if (!d || !key)
+  if (n == 0)
   {
-    error_callback("%s: invalid input\n", __func__);
-    return def;
+    return 0;
   }
 
-  unsigned int index = dictionary_hash(key) % d->size;
-  struct bucket *curr = d->table[index];
-  while (curr)
+  /* The key of an overlay may be in a layer: one by one */
+  if (d->layers)
   {
-    if (strcmp(curr->key, key) == 0)
+    for (size_t i = 0; i < n; i++)
     {
-      return curr->value;
+      if (dictionary_set(d, keys[i], vals ? vals[i] : NULL) != 0)
+      {
+        return -1;
+      }
     }
-    curr = curr->next;
+    return 0;
   }
 
-  return def;
+  DICT_STAT(allocs);
+  struct bulk_entry *e = malloc(n * sizeof(struct bulk_entry));
+  if (!e)
+  {
+    error_callback("%s: malloc() failed\n", __func__);
+    return -1;
+  }
+  for (size_t i = 0; i < n; i++)
+  {
+    e[i].key = keys[i];
+    e[i].val = vals ? vals[i] : NULL;
+    e[i].hash = dictionary_hash(keys[i]);
+  }
+  int ret = bulk_insert(d, e, n, 0, __func__);
+  free(e);
+  return ret;
 }
 
-int dictionary_set(struct dictionary *d, const char *key, const char *val)
+int dictionary_merge(struct dictionary *dst, const struct dictionary *src,
+                     enum dictionary_merge_policy policy)
 {
-  if (!d || !key)
+  if (!dst || !src || dst == src)
   {
     error_callback("%s: invalid input\n", __func__);
     return -1;
   }
 
-  unsigned int index = dictionary_hash(key) % d->size;
-  struct bucket *curr = d->table[index];
-  while (curr)
+  if (dst->image)
+  {
+    error_callback("%s: read-only dictionary\n", __func__);
+    return -1;
+  }
+
+  int keep = policy == DICTIONARY_MERGE_KEEP;
+  struct dictionary_iter it;
+  const char *key;
+  const char *val;
+  if (dst->layers)
   {
-    if (strcmp(curr->key, key) == 0)
+    dictionary_iter_init(&it, src);
+    while (dictionary_iter_next(&it, &key, &val))
     {
-      free(curr->value);
-      if (val)
+      if (keep && dictionary_get(dst, key, layer_missing) != layer_missing)
       {
-        curr->value = strdup(val);
-        if (!curr->value)
-        {
-          error_callback("%s: strdup() failed\n", __func__);
-          return -1;
-        }
+        continue;
       }
-      else
+      if (dictionary_set(dst, key, val) != 0)
       {
-        curr->value = NULL; // Set to NULL if val is NULL
+        return -1;
       }
-      return 0;
     }
-    curr = curr->next;
+    return 0;
   }
 
-  if (d->numOfElements >= d->size * 0.7)
+  size_t n = src->numOfElements;
+  if (src->layers)
   {
-    if (dictionary_grow(d) != 0)
+    n = 0;
+    dictionary_iter_init(&it, src);
+    while (dictionary_iter_next(&it, &key, &val))
     {
-      error_callback("%s: dictionary_grow() failed\n", __func__);
-      return -1;
+      n++;
     }
   }
+  if (n == 0)
+  {
+    return 0;
+  }
 
-  struct bucket *new_bucket = malloc(sizeof(struct bucket));
-  if (!new_bucket)
+  DICT_STAT(allocs);
+  struct bulk_entry *e = malloc(n * sizeof(struct bulk_entry));
+  if (!e)
   {
     error_callback("%s: malloc() failed\n", __func__);
     return -1;
   }
+  /* Buckets of src carry their hash: only image entries are hashed again */
+  size_t i = 0;
+  dictionary_iter_init(&it, src);
+  while (i < n && dictionary_iter_next(&it, &key, &val))
+  {
+    e[i].key = key;
+    e[i].val = val;
+    e[i].hash = it.pos ? it.pos->hash : dictionary_hash(key);
+    i++;
+  }
+  int ret = bulk_insert(dst, e, i, keep, __func__);
+  free(e);
+  return ret;
+}
 
-  new_bucket->key = strdup(key);
-  if (!new_bucket->key)
+/* Image dictionaries have nothing to share: the clone is a plain copy */
+static struct dictionary *dictionary_copy(const struct dictionary *d)
+{
+  struct dictionary *c = dictionary_new(d->numOfElements * 2);
+  struct dictionary_iter it;
+  const char *key;
+  const char *val;
+
+  dictionary_iter_init(&it, d);
+  while (c && dictionary_iter_next(&it, &key, &val))
   {
-    error_callback("%s: strdup() failed\n", __func__);
-    free(new_bucket);
-    return -1;
+    if (dictionary_set(c, key, val) != 0)
+    {
+      dictionary_del(c);
+      c = NULL;
+    }
+  }
+  return c;
+}
+
+struct dictionary *dictionary_clone(struct dictionary *d)
+{
+  if (!d)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return NULL;
+  }
+
+  if (d->image)
+  {
+    return dictionary_copy(d);
+  }
+
+  DICT_STAT(allocs);
+  struct dictionary *c = malloc(sizeof(struct dictionary));
+  if (!c)
+  {
+    error_callback("%s: malloc() failed\n", __func__);
+    return NULL;
+  }
+  c->pool = NULL;
+  if (d->intern && !(c->pool = pool_new()))
+  {
+    error_callback("%s: malloc() failed\n", __func__);
+    free(c);
+    return NULL;
   }
 
-  if (val)
+  /* Written to since the last clone: its buckets become shared as well */
+  if (!d->shared || d->table != d->shared->table)
   {
-    new_bucket->value = strdup(val);
-    if (!new_bucket->value)
+    struct dict_pool *pool = NULL;
+    DICT_STAT(allocs);
+    struct dict_shared *s = malloc(sizeof(struct dict_shared));
+    if (!s || (d->intern && !(pool = pool_new())))
     {
-      error_callback("%s: strdup() failed\n", __func__);
-      free(new_bucket->key);
-      free(new_bucket);
-      return -1;
+      error_callback("%s: malloc() failed\n", __func__);
+      free(s);
+      if (c->pool)
+      {
+        pool_del(c->pool);
+      }
+      free(c);
+      return NULL;
     }
+    s->refs = 1;
+    s->size = d->size;
+    s->table = d->table;
+    s->parent = d->shared;
+    s->pool = d->pool;
+    s->chunks = d->chunks;
+    s->holds = d->holds;
+    d->pool = pool;
+    d->chunks = NULL;
+    d->holds = NULL;
+    d->shared = s;
   }
-  else
+
+  __atomic_add_fetch(&d->shared->refs, 1, __ATOMIC_RELAXED);
+  c->numOfElements = d->numOfElements;
+  c->size = d->size;
+  c->table = d->table;
+  c->intern = d->intern;
+  c->chunks = NULL;
+  c->holds = NULL;
+  c->watch = NULL;
+  c->shared = d->shared;
+  c->layers = NULL;
+  c->image = NULL;
+  c->maplen = 0;
+  if (d->layers)
   {
-    new_bucket->value = NULL;
+    size_t len = sizeof(struct dict_layers) +
+                 d->layers->n * sizeof(const struct dictionary *);
+    DICT_STAT(allocs);
+    c->layers = malloc(len);
+    if (!c->layers)
+    {
+      error_callback("%s: malloc() failed\n", __func__);
+      dictionary_del(c);
+      return NULL;
+    }
+    memcpy(c->layers, d->layers, len);
   }
+  dictionary_touch(c);
+  return c;
+}
 
-  new_bucket->next = d->table[index];
-  d->table[index] = new_bucket;
-  d->numOfElements++;
+int dictionary_set_interning(struct dictionary *d, int enable)
+{
+  if (!d)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return -1;
+  }
+
+  if (d->image)
+  {
+    error_callback("%s: read-only dictionary\n", __func__);
+    return -1;
+  }
 
+  if (enable && !d->pool)
+  {
+    d->pool = pool_new();
+    if (!d->pool)
+    {
+      error_callback("%s: malloc() failed\n", __func__);
+      return -1;
+    }
+  }
+  d->intern = enable ? 1 : 0;
   return 0;
 }
 
@@ -238,27 +1500,75 @@ void dictionary_unset(struct dictionary *d, const char *key)
     return;
   }
 
-  unsigned int index = dictionary_hash(key) % d->size;
+  if (d->image)
+  {
+    error_callback("%s: read-only dictionary\n", __func__);
+    return;
+  }
+
+  unsigned int hash = dictionary_hash(key);
+  const char *below;
+  if (d->layers && layers_get(d, 0, d->layers->n, key, hash, &below))
+  {
+    struct bucket *b = table_lookup(d, key, hash);
+    if (b && (b->flags & BUCKET_TOMBSTONE))
+    {
+      return;
+    }
+    if (d->watch)
+    {
+      dictionary_batch_begin(d);
+    }
+    if (dictionary_insert(d, key, NULL, 0, __func__) == 0)
+    {
+      b = table_lookup(d, key, hash);
+      b->flags |= BUCKET_TOMBSTONE;
+      dictionary_touch(d);
+      if (d->watch)
+      {
+        dict_watch_changed(d, key);
+      }
+    }
+    if (d->watch)
+    {
+      dictionary_batch_end(d);
+    }
+    return;
+  }
 
+  unsigned int index = hash % d->size;
   struct bucket *curr = d->table[index];
   struct bucket *prev = NULL;
 
   while (curr)
   {
-    if (strcmp(curr->key, key) == 0)
+    DICT_STAT(probes);
+    if (curr->hash == hash && (DICT_STAT(strcmps), strcmp(curr->key, key) == 0))
     {
-      if (!prev)
+      int shared = bucket_is_shared(d, index, curr);
+      struct bucket **link = prev ? &prev->next : &d->table[index];
+      if (shared && !(link = chain_unshare(d, index, curr)))
       {
-        d->table[index] = curr->next;
+        error_callback("%s: malloc() failed\n", __func__);
+        return;
       }
-      else
+      *link = curr->next;
+      /* Queued now: key may be the one bucket_free() releases */
+      if (d->watch)
       {
-        prev->next = curr->next;
+        dictionary_batch_begin(d);
+        dict_watch_changed(d, key);
+      }
+      if (!shared)
+      {
+        bucket_free(d, curr);
       }
-      free(curr->key);
-      free(curr->value);
-      free(curr);
       d->numOfElements--;
+      dictionary_touch(d);
+      if (d->watch)
+      {
+        dictionary_batch_end(d);
+      }
       return;
     }
     prev = curr;
@@ -274,21 +1584,109 @@ void dictionary_dump(const struct dictionary *d, FILE *out)
     return;
   }
 
-  if (d->numOfElements < 1)
+  if (d->numOfElements < 1 && !d->layers)
   {
     error_callback("%s: empty dictionary\n", __func__);
     return;
   }
 
-  for (unsigned int i = 0; i < d->size; i++)
+  DICT_TRACE_BEGIN(__func__, d);
+  struct dictionary_iter it;
+  const char *key, *val;
+  dictionary_iter_init(&it, d);
+  while (dictionary_iter_next(&it, &key, &val))
   {
-    struct bucket *curr = d->table[i];
-    while (curr)
+    fprintf(out, "%20s\t[%s]\n", key, val ? val : "UNDEF");
+  }
+  DICT_TRACE_END(__func__, d);
+  return;
+}
+
+void dictionary_iter_init(struct dictionary_iter *it,
+                          const struct dictionary *d)
+{
+  it->d = d;
+  it->slot = 0;
+  it->pos = NULL;
+  it->layer = 0;
+}
+
+/* Next entry of d itself, leaving any layers under it aside */
+static int iter_step(struct dictionary_iter *it, const struct dictionary *d,
+                     const char **key, const char **val)
+{
+  if (d->image)
+  {
+    while (it->slot < d->numOfElements)
     {
-      fprintf(out, "%20s\t[%s]\n", curr->key,
-              curr->value ? curr->value : "UNDEF");
-      curr = curr->next;
+      if (dict_image_entry(d->image, it->slot++, key, val) == 0)
+      {
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  if (it->pos)
+  {
+    it->pos = it->pos->next;
+  }
+  while (!it->pos && it->slot < d->size)
+  {
+    it->pos = d->table[it->slot++];
+  }
+  if (!it->pos)
+  {
+    return 0;
+  }
+  *key = it->pos->key;
+  *val = it->pos->value;
+  return 1;
+}
+
+/* Overlays: the top table without its tombstones, then each layer top down
+ * without the keys that the table or a higher layer has */
+int dictionary_iter_next(struct dictionary_iter *it, const char **key,
+                         const char **val)
+{
+  const struct dictionary *d = it->d;
+  if (!d)
+  {
+    return 0;
+  }
+  if (!d->layers)
+  {
+    return iter_step(it, d, key, val);
+  }
+
+  for (;;)
+  {
+    const struct dictionary *l = it->layer ? d->layers->d[it->layer - 1] : d;
+    if (!iter_step(it, l, key, val))
+    {
+      if (it->layer == d->layers->n)
+      {
+        return 0;
+      }
+      it->layer++;
+      it->slot = 0;
+      it->pos = NULL;
+      continue;
+    }
+    if (it->layer == 0)
+    {
+      if (!(it->pos->flags & BUCKET_TOMBSTONE))
+      {
+        return 1;
+      }
+      continue;
+    }
+    unsigned int hash = it->pos ? it->pos->hash : dictionary_hash(*key);
+    const char *above;
+    if (!table_lookup(d, *key, hash) &&
+        !layers_get(d, 0, it->layer - 1, *key, hash, &above))
+    {
+      return 1;
     }
   }
-  return;
 }
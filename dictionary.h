@@ -1,21 +1,74 @@
 #ifndef _DICTIONARY_H_
 #define _DICTIONARY_H_
 
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 extern int (*error_callback)(const char *, ...);
 void dictionary_set_error_callback(int (*errback)(const char *, ...));
 
-#include <stdio.h>
+/* Keys and values short enough to fit (including the terminating NUL) are
+ * stored inside the bucket itself; longer ones live on the heap. The value
+ * buffer (vbuf, vcap bytes) is kept across overwrites and only grows.
+ * ctag/cbits cache the last typed conversion of the value (see
+ * dictionary_private.h); any dictionary_set() of the key clears it. */
+#define DICT_INLINE_KEY 24
+#define DICT_INLINE_VAL 16
 
 struct bucket {
 	char *key;
 	char *value;
 	struct bucket *next;
+	char *vbuf;
+	size_t vcap;
+	unsigned int hash;
+	unsigned char flags;
+	unsigned char ctag;
+	uint64_t cbits;
+	char key_buf[DICT_INLINE_KEY];
+	char val_buf[DICT_INLINE_VAL];
 };
 
+struct dict_pool;
+struct dict_chunk;
+struct dict_hold;
+struct dict_watchers;
+struct dict_shared;
+struct dict_layers;
+struct dict_image_header;
+
 struct dictionary {
 	unsigned int numOfElements;
 	unsigned int size;
 	struct bucket **table;
+	/* Changes whenever entries are added, removed or moved; values are
+	 * unique across all dictionaries in the process. */
+	unsigned long generation;
+	int intern;
+	struct dict_pool *pool;
+	struct dict_chunk *chunks;
+	struct dict_hold *holds;
+	struct dict_watchers *watch;
+	/* Buckets shared with copy-on-write clones, see dictionary_clone() */
+	struct dict_shared *shared;
+	/* Read-only layers under an overlay, see dictionary_overlay() */
+	struct dict_layers *layers;
+	/* Read-only dictionaries served from a snapshot image have no table */
+	const struct dict_image_header *image;
+	size_t maplen;
+};
+
+/* Visits every entry once, in unspecified order. The dictionary must not be
+ * modified while an iteration is in progress. */
+struct dictionary_iter {
+	const struct dictionary *d;
+	unsigned int slot;
+	const struct bucket *pos;
+	unsigned int layer;
 };
 
 unsigned dictionary_hash(const char *key);
@@ -23,8 +76,141 @@ struct dictionary *dictionary_new(size_t size);
 void dictionary_del(struct dictionary *d);
 const char *dictionary_get(const struct dictionary *d, const char *key,
 													 const char *def);
+/* Same as dictionary_get() with hash == dictionary_hash(key) precomputed */
+const char *dictionary_get_hashed(const struct dictionary *d, const char *key,
+																	unsigned hash, const char *def);
 int dictionary_set(struct dictionary *vd, const char *key, const char *val);
 void dictionary_unset(struct dictionary *d, const char *key);
 void dictionary_dump(const struct dictionary *d, FILE *out);
+void dictionary_iter_init(struct dictionary_iter *it,
+													const struct dictionary *d);
+int dictionary_iter_next(struct dictionary_iter *it, const char **key,
+												 const char **val);
+
+/* Copy-on-write clone: d and the clone share their buckets, so cloning
+ * costs the same whatever the size of d. Afterwards either side can be
+ * modified, or used from its own thread, without the other seeing it. A
+ * write to a shared entry copies it and the entries chained before it in
+ * its slot; the first write of each side copies the slot array. Release
+ * the clone with dictionary_del(), in any order with d. Cloning an image
+ * dictionary gives a plain, writable copy. */
+struct dictionary *dictionary_clone(struct dictionary *d);
+
+/* Overlay over n read-only layers, layers[0] at the bottom: a lookup returns
+ * the value of the highest layer that has the key. The overlay has its own
+ * table on top, where dictionary_set() writes; dictionary_unset() of a key
+ * that a layer has leaves a tombstone there hiding it. Iteration visits the
+ * merged entries without building them. The layers are not copied: they
+ * must outlive the overlay, and changes made to them show through. Layers
+ * cannot be overlays themselves. numOfElements only counts the top table,
+ * tombstones included. */
+struct dictionary *dictionary_overlay(struct dictionary *const *layers,
+																			size_t n);
+
+/* Bulk inserts, sizing the table once and taking the new entries from a
+ * single allocation. dictionary_set_many() sets keys[i] to vals[i] (vals
+ * may be NULL for NULL values); a key given twice ends with its last value.
+ * dictionary_merge() copies every entry of src into dst; for a key that dst
+ * already has, DICTIONARY_MERGE_OVERWRITE takes the value of src and
+ * DICTIONARY_MERGE_KEEP leaves it. On failure, part of the entries may have
+ * been set. */
+enum dictionary_merge_policy {
+	DICTIONARY_MERGE_OVERWRITE,
+	DICTIONARY_MERGE_KEEP
+};
+
+int dictionary_set_many(struct dictionary *d, const char *const *keys,
+												const char *const *vals, size_t n);
+int dictionary_merge(struct dictionary *dst, const struct dictionary *src,
+										 enum dictionary_merge_policy policy);
+
+/* With interning enabled, values set afterwards are stored once in a
+ * refcounted pool owned by the dictionary: equal values share storage and
+ * dictionary_get() returns the same pointer for them. */
+int dictionary_set_interning(struct dictionary *d, int enable);
+
+/* Change notifications: cb receives the keys starting with prefix ("" for
+ * all) that dictionary_set() or dictionary_unset() added, changed or
+ * removed. Setting a key to the value it already has is not a change.
+ * Between dictionary_batch_begin() and dictionary_batch_end(), which nest,
+ * changes are coalesced and delivered when the outermost batch ends, each
+ * key once; otherwise after every call. Keys are sorted and only valid
+ * during the call. cb may modify d: its changes are delivered in another
+ * round once every callback has returned. dictionary_watch() returns an id
+ * for dictionary_unwatch(), or -1. */
+typedef void (*dictionary_watch_cb)(struct dictionary *d,
+																		const char *const *keys, size_t n,
+																		void *ctx);
+int dictionary_watch(struct dictionary *d, const char *prefix,
+										 dictionary_watch_cb cb, void *ctx);
+int dictionary_unwatch(struct dictionary *d, int id);
+void dictionary_batch_begin(struct dictionary *d);
+void dictionary_batch_end(struct dictionary *d);
+
+/* Versioned, checksummed binary image of a dictionary: the hash index and
+ * packed strings are stored as-is, so loading needs no parsing or
+ * rehashing. Images are only readable on hosts with the same byte order. */
+int dictionary_save_binary(const struct dictionary *d, FILE *out);
+struct dictionary *dictionary_load_binary(FILE *in);
+
+/* Maps a snapshot written by dictionary_save_binary() read-only and serves
+ * lookups straight from the mapped pages. Only the header is validated up
+ * front (use dictionary_load_binary() to verify the checksum); offsets are
+ * bounds-checked as they are followed. dictionary_set() and
+ * dictionary_unset() fail on the result; release it with dictionary_del(). */
+struct dictionary *dictionary_open_mapped(const char *path);
+
+/* The same image published in a POSIX shared-memory object, so every process
+ * on the host maps one copy. Publishing again replaces the object: readers
+ * keep their old mapping until they reopen. The image magic is stored last
+ * with release semantics and loaded with acquire semantics, so
+ * dictionary_shm_open() returns NULL if the object is missing or still being
+ * written and never sees a partial body. */
+int dictionary_shm_publish(const struct dictionary *d, const char *name);
+struct dictionary *dictionary_shm_open(const char *name);
+int dictionary_shm_unlink(const char *name);
+
+/* A published dictionary that other threads can replace while it is read.
+ * dict_snapshot_acquire() never blocks or fails: it returns the current
+ * dictionary with a reference held, and it stays valid, along with every
+ * value read from it, until dict_snapshot_release(). dict_root_publish()
+ * swaps in a new dictionary; the previous one is released with
+ * dictionary_del() once its last snapshot is. The root owns the dictionaries
+ * it is given, unless creating or publishing fails. Snapshots must not be
+ * modified, and may outlive dict_root_del(). */
+struct dict_root;
+struct dict_snapshot {
+	const struct dictionary *dict;
+};
+
+struct dict_root *dict_root_new(struct dictionary *d);
+int dict_root_publish(struct dict_root *r, struct dictionary *d);
+void dict_root_del(struct dict_root *r);
+struct dict_snapshot *dict_snapshot_acquire(struct dict_root *r);
+void dict_snapshot_release(struct dict_snapshot *s);
+
+/* Operation counters, per calling thread. Only collected when the library
+ * is built with -DDICTIONARY_STATS; otherwise dictionary_stats_get()
+ * returns -1 and the trace hooks are never invoked. */
+struct dictionary_stats {
+	unsigned long get_hits;
+	unsigned long get_misses;
+	unsigned long probes;
+	unsigned long strcmps;
+	unsigned long grows;
+	unsigned long allocs;
+	unsigned long ini_lookups;
+	unsigned long ini_conversions;
+	unsigned long ini_cache_hits;
+};
+
+int dictionary_stats_get(struct dictionary_stats *out);
+void dictionary_stats_reset(void);
+void dictionary_set_trace_hooks(void (*begin)(const char *, const void *),
+																void (*end)(const char *, const void *));
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -0,0 +1,804 @@
+#include "dictionary_image.h"
+#include "dictionary_private.h"
+#include "dictionary_stats.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint32_t image_checksum(const unsigned char *p, size_t len)
+{
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; i++)
+  {
+    hash ^= p[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+size_t dict_image_size(const struct dict_image_header *h)
+{
+  uint64_t size = sizeof(struct dict_image_header) +
+                  (uint64_t)h->ngroups * sizeof(uint32_t) +
+                  (uint64_t)h->nbuckets * sizeof(uint32_t) +
+                  (uint64_t)h->nentries * sizeof(struct dict_image_entry) +
+                  h->strsize;
+  if (size > SIZE_MAX)
+  {
+    return 0;
+  }
+  return (size_t)size;
+}
+
+/* A 32-bit finalizer: keys of a group that collide under one seed rarely
+ * do under the next */
+static uint32_t image_mix(uint32_t hash, uint32_t seed)
+{
+  uint32_t x = hash ^ (seed * 0x9e3779b9u);
+  x ^= x >> 16;
+  x *= 0x85ebca6bu;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35u;
+  x ^= x >> 16;
+  return x;
+}
+
+uint32_t dict_image_slot(const struct dict_image_header *h, unsigned int hash)
+{
+  if (!h->ngroups)
+  {
+    return hash % h->nbuckets;
+  }
+  uint32_t seed = DICT_IMAGE_GROUPS(h)[hash % h->ngroups];
+  return image_mix(hash, seed) % h->nbuckets;
+}
+
+/* numOfElements of an overlay leaves its layers out */
+static unsigned int entry_count(const struct dictionary *d)
+{
+  if (!d->layers)
+  {
+    return d->numOfElements;
+  }
+  struct dictionary_iter it;
+  const char *key, *val;
+  unsigned int n = 0;
+  dictionary_iter_init(&it, d);
+  while (dictionary_iter_next(&it, &key, &val))
+  {
+    n++;
+  }
+  return n;
+}
+
+static void *image_build(const struct dictionary *d, unsigned int nbuckets,
+                         const uint32_t *groups, uint32_t ngroups,
+                         size_t *len)
+{
+  struct dictionary_iter it;
+  const char *key, *val;
+  uint64_t strsize = 0;
+  dictionary_iter_init(&it, d);
+  while (dictionary_iter_next(&it, &key, &val))
+  {
+    strsize += strlen(key) + 1;
+    if (val)
+    {
+      strsize += strlen(val) + 1;
+    }
+  }
+  if (strsize >= DICT_IMAGE_NONE)
+  {
+    error_callback("%s: dictionary too large\n", __func__);
+    return NULL;
+  }
+
+  struct dict_image_header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, DICT_IMAGE_MAGIC, sizeof(DICT_IMAGE_MAGIC));
+  h.version = DICT_IMAGE_VERSION;
+  h.byteorder = DICT_IMAGE_BYTEORDER;
+  h.nbuckets = nbuckets;
+  h.ngroups = ngroups;
+  h.nentries = entry_count(d);
+  h.strsize = (uint32_t)strsize;
+
+  size_t size = dict_image_size(&h);
+  DICT_STAT(allocs);
+  unsigned char *img = calloc(1, size);
+  /* Per-slot fill position while laying chains out contiguously */
+  DICT_STAT(allocs);
+  uint32_t *fill = calloc(nbuckets, sizeof(uint32_t));
+  if (!img || !fill)
+  {
+    error_callback("%s: calloc() failed\n", __func__);
+    free(img);
+    free(fill);
+    return NULL;
+  }
+
+  memcpy(img, &h, sizeof(h));
+  if (ngroups)
+  {
+    memcpy(img + sizeof(h), groups, ngroups * sizeof(uint32_t));
+  }
+  struct dict_image_header *hp = (struct dict_image_header *)img;
+  uint32_t *heads = (uint32_t *)DICT_IMAGE_HEADS(hp);
+  struct dict_image_entry *entries =
+      (struct dict_image_entry *)DICT_IMAGE_ENTRIES(hp);
+  char *strings = (char *)DICT_IMAGE_STRINGS(hp);
+
+  /* Count chain lengths, then turn them into start offsets */
+  dictionary_iter_init(&it, d);
+  while (dictionary_iter_next(&it, &key, &val))
+  {
+    fill[dict_image_slot(hp, dictionary_hash(key))]++;
+  }
+  uint32_t start = 0;
+  for (unsigned int i = 0; i < nbuckets; i++)
+  {
+    uint32_t n = fill[i];
+    fill[i] = start;
+    heads[i] = n ? start + 1 : 0;
+    start += n;
+  }
+
+  uint32_t stroff = 0;
+  dictionary_iter_init(&it, d);
+  while (dictionary_iter_next(&it, &key, &val))
+  {
+    unsigned int hash = dictionary_hash(key);
+    uint32_t slot = dict_image_slot(hp, hash);
+    uint32_t idx = fill[slot]++;
+    struct dict_image_entry *e = &entries[idx];
+
+    e->hash = hash;
+    e->next = 0;
+    if (idx > heads[slot] - 1)
+    {
+      entries[idx - 1].next = idx + 1;
+    }
+
+    size_t klen = strlen(key) + 1;
+    memcpy(strings + stroff, key, klen);
+    e->key = stroff;
+    stroff += klen;
+
+    e->value = DICT_IMAGE_NONE;
+    if (val)
+    {
+      size_t vlen = strlen(val) + 1;
+      memcpy(strings + stroff, val, vlen);
+      e->value = stroff;
+      stroff += vlen;
+    }
+  }
+  free(fill);
+
+  hp->checksum = image_checksum(img + sizeof(h), size - sizeof(h));
+  *len = size;
+  return img;
+}
+
+void *dict_image_build(const struct dictionary *d, unsigned int nbuckets,
+                       size_t *len)
+{
+  if (!d || !len || nbuckets == 0)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return NULL;
+  }
+  return image_build(d, nbuckets, NULL, 0, len);
+}
+
+/* Perfect hash index (CHD): the hashes are split into groups of about
+ * PERFECT_GROUP keys, and the groups, largest first, each get the first
+ * seed sending all their keys to free slots. The last groups, of one key,
+ * take a number of tries in the order of the bucket count. */
+#define PERFECT_GROUP 4
+#define PERFECT_TRIES(m) (64u * (m) + 1024u)
+
+struct perfect_group
+{
+  uint32_t size;
+  uint32_t first;
+  uint32_t group;
+};
+
+static int u32_cmp(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static int group_cmp(const void *a, const void *b)
+{
+  const struct perfect_group *x = a;
+  const struct perfect_group *y = b;
+  if (x->size != y->size)
+  {
+    return x->size > y->size ? -1 : 1;
+  }
+  return x->group < y->group ? -1 : x->group > y->group;
+}
+
+/* Seeds placing the n distinct hashes in m slots: 0, 1 if some group found
+ * no seed, -1 when out of memory */
+static int perfect_seeds(const uint32_t *hashes, uint32_t n, uint32_t m,
+                         uint32_t *seeds, uint32_t ngroups)
+{
+  DICT_STAT(allocs);
+  struct perfect_group *g = calloc(ngroups, sizeof(struct perfect_group));
+  DICT_STAT(allocs);
+  unsigned char *taken = calloc(m, 1);
+  DICT_STAT(allocs);
+  uint32_t *slots = malloc(2 * n * sizeof(uint32_t));
+  if (!g || !taken || !slots)
+  {
+    free(g);
+    free(taken);
+    free(slots);
+    return -1;
+  }
+  uint32_t *sorted = slots + n;
+
+  for (uint32_t i = 0; i < ngroups; i++)
+  {
+    g[i].group = i;
+  }
+  for (uint32_t i = 0; i < n; i++)
+  {
+    g[hashes[i] % ngroups].size++;
+  }
+  uint32_t first = 0;
+  for (uint32_t i = 0; i < ngroups; i++)
+  {
+    g[i].first = first;
+    first += g[i].size;
+  }
+  /* size counts the members placed so far, back to the total at the end */
+  for (uint32_t i = 0; i < ngroups; i++)
+  {
+    g[i].size = 0;
+  }
+  for (uint32_t i = 0; i < n; i++)
+  {
+    struct perfect_group *gi = &g[hashes[i] % ngroups];
+    sorted[gi->first + gi->size++] = hashes[i];
+  }
+  qsort(g, ngroups, sizeof(*g), group_cmp);
+
+  int ret = 0;
+  for (uint32_t i = 0; i < ngroups && ret == 0; i++)
+  {
+    const uint32_t *keys = sorted + g[i].first;
+    uint32_t k = g[i].size;
+    uint32_t seed = 0;
+    for (;; seed++)
+    {
+      if (seed == PERFECT_TRIES(m))
+      {
+        ret = 1;
+        break;
+      }
+      uint32_t j = 0;
+      for (; j < k; j++)
+      {
+        slots[j] = image_mix(keys[j], seed) % m;
+        if (taken[slots[j]])
+        {
+          break;
+        }
+        taken[slots[j]] = 1;
+      }
+      if (j == k)
+      {
+        break;
+      }
+      while (j--)
+      {
+        taken[slots[j]] = 0;
+      }
+    }
+    seeds[g[i].group] = seed;
+  }
+
+  free(g);
+  free(taken);
+  free(slots);
+  return ret;
+}
+
+void *dict_image_build_perfect(const struct dictionary *d, size_t *len)
+{
+  if (!d || !len)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return NULL;
+  }
+
+  uint32_t n = entry_count(d);
+  if (n == 0)
+  {
+    return image_build(d, 1, NULL, 0, len);
+  }
+
+  DICT_STAT(allocs);
+  uint32_t *hashes = malloc(n * sizeof(uint32_t));
+  if (!hashes)
+  {
+    error_callback("%s: malloc() failed\n", __func__);
+    return NULL;
+  }
+  struct dictionary_iter it;
+  const char *key, *val;
+  uint32_t count = 0;
+  dictionary_iter_init(&it, d);
+  while (count < n && dictionary_iter_next(&it, &key, &val))
+  {
+    hashes[count++] = dictionary_hash(key);
+  }
+
+  /* Keys with the same hash share a slot: place each hash once, grouped */
+  qsort(hashes, count, sizeof(uint32_t), u32_cmp);
+  uint32_t u = 0;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    if (u == 0 || hashes[i] != hashes[u - 1])
+    {
+      hashes[u++] = hashes[i];
+    }
+  }
+  uint32_t ngroups = u / PERFECT_GROUP + 1;
+
+  DICT_STAT(allocs);
+  uint32_t *seeds = malloc(ngroups * sizeof(uint32_t));
+  void *img = NULL;
+  int ret = -1;
+  if (seeds)
+  {
+    /* One bucket per key, or a few more if some group finds no seed */
+    uint32_t m = u;
+    while ((ret = perfect_seeds(hashes, u, m, seeds, ngroups)) == 1 &&
+           m < UINT32_MAX / 2)
+    {
+      m += m / 16 + 1;
+    }
+    if (ret == 0)
+    {
+      img = image_build(d, m, seeds, ngroups, len);
+    }
+  }
+  if (ret < 0)
+  {
+    error_callback("%s: malloc() failed\n", __func__);
+  }
+  else if (ret > 0)
+  {
+    error_callback("%s: no perfect hash found\n", __func__);
+  }
+  free(seeds);
+  free(hashes);
+  return img;
+}
+
+int dict_image_check(const void *img, size_t len)
+{
+  const struct dict_image_header *h = img;
+
+  if (!img || len < sizeof(*h) ||
+      memcmp(h->magic, DICT_IMAGE_MAGIC, sizeof(DICT_IMAGE_MAGIC)) != 0)
+  {
+    error_callback("%s: not a dictionary image\n", __func__);
+    return -1;
+  }
+  if (h->version != DICT_IMAGE_VERSION || h->byteorder != DICT_IMAGE_BYTEORDER)
+  {
+    error_callback("%s: unsupported image version or byte order\n", __func__);
+    return -1;
+  }
+  if (h->nbuckets == 0 || dict_image_size(h) != len)
+  {
+    error_callback("%s: truncated image\n", __func__);
+    return -1;
+  }
+  if (image_checksum((const unsigned char *)img + sizeof(*h),
+                     len - sizeof(*h)) != h->checksum)
+  {
+    error_callback("%s: checksum mismatch\n", __func__);
+    return -1;
+  }
+
+  const uint32_t *heads = DICT_IMAGE_HEADS(h);
+  const struct dict_image_entry *entries = DICT_IMAGE_ENTRIES(h);
+  const char *strings = DICT_IMAGE_STRINGS(h);
+
+  if (h->nentries && (h->strsize == 0 || strings[h->strsize - 1] != '\0'))
+  {
+    error_callback("%s: corrupt string table\n", __func__);
+    return -1;
+  }
+  for (uint32_t i = 0; i < h->nbuckets; i++)
+  {
+    if (heads[i] > h->nentries)
+    {
+      error_callback("%s: corrupt hash index\n", __func__);
+      return -1;
+    }
+  }
+  for (uint32_t i = 0; i < h->nentries; i++)
+  {
+    const struct dict_image_entry *e = &entries[i];
+    /* Chains only point forward, so lookups always terminate */
+    if (e->key >= h->strsize ||
+        (e->value != DICT_IMAGE_NONE && e->value >= h->strsize) ||
+        (e->next && (e->next <= i + 1 || e->next > h->nentries)))
+    {
+      error_callback("%s: corrupt entry %u\n", __func__, i);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+const char *dict_image_get(const struct dict_image_header *h, const char *key,
+                           unsigned int hash, const char *def)
+{
+  const uint32_t *heads = DICT_IMAGE_HEADS(h);
+  const struct dict_image_entry *entries = DICT_IMAGE_ENTRIES(h);
+  const char *strings = DICT_IMAGE_STRINGS(h);
+
+  uint32_t idx = heads[dict_image_slot(h, hash)];
+  while (idx && idx <= h->nentries)
+  {
+    const struct dict_image_entry *e = &entries[idx - 1];
+    DICT_STAT(probes);
+    if (e->hash == hash && e->key < h->strsize)
+    {
+      DICT_STAT(strcmps);
+      if (strcmp(strings + e->key, key) == 0)
+      {
+        if (e->value == DICT_IMAGE_NONE)
+        {
+          DICT_STAT(get_hits);
+          return NULL;
+        }
+        if (e->value < h->strsize)
+        {
+          DICT_STAT(get_hits);
+          return strings + e->value;
+        }
+        break;
+      }
+    }
+    if (e->next <= idx)
+    {
+      break;
+    }
+    idx = e->next;
+  }
+
+  DICT_STAT(get_misses);
+  return def;
+}
+
+int dict_image_entry(const struct dict_image_header *h, uint32_t i,
+                     const char **key, const char **val)
+{
+  if (i >= h->nentries)
+  {
+    return -1;
+  }
+
+  const struct dict_image_entry *e = &DICT_IMAGE_ENTRIES(h)[i];
+  const char *strings = DICT_IMAGE_STRINGS(h);
+  if (e->key >= h->strsize ||
+      (e->value != DICT_IMAGE_NONE && e->value >= h->strsize))
+  {
+    return -1;
+  }
+  *key = strings + e->key;
+  *val = e->value == DICT_IMAGE_NONE ? NULL : strings + e->value;
+  return 0;
+}
+
+void dict_image_unmap(const struct dict_image_header *h, size_t maplen)
+{
+  if (maplen)
+  {
+    munmap((void *)h, maplen);
+  }
+}
+
+/* Map an open image file read-only and wrap it; consumes fd */
+static struct dictionary *image_map_fd(int fd, const char *name)
+{
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      (uint64_t)st.st_size < sizeof(struct dict_image_header) ||
+      (uint64_t)st.st_size > SIZE_MAX)
+  {
+    error_callback("%s: not a dictionary image: %s\n", __func__, name);
+    close(fd);
+    return NULL;
+  }
+  size_t len = (size_t)st.st_size;
+  void *map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    error_callback("%s: mmap() failed\n", __func__);
+    return NULL;
+  }
+
+  /* Pairs with the release store of the magic in dictionary_shm_publish():
+   * once it is seen, the rest of the image is too */
+  uint64_t magic;
+  memcpy(&magic, DICT_IMAGE_MAGIC, sizeof(magic));
+  if (__atomic_load_n((const uint64_t *)map, __ATOMIC_ACQUIRE) != magic)
+  {
+    error_callback("%s: not a dictionary image: %s\n", __func__, name);
+    munmap(map, len);
+    return NULL;
+  }
+
+  struct dictionary *d = dict_image_view(map, len);
+  if (!d)
+  {
+    munmap(map, len);
+    return NULL;
+  }
+  d->maplen = len;
+  return d;
+}
+
+struct dictionary *dictionary_open_mapped(const char *path)
+{
+  if (!path)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return NULL;
+  }
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    error_callback("%s: cannot open %s\n", __func__, path);
+    return NULL;
+  }
+  return image_map_fd(fd, path);
+}
+
+int dictionary_shm_publish(const struct dictionary *d, const char *name)
+{
+  if (!d || !name)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return -1;
+  }
+
+  size_t len;
+  unsigned char *img = dict_image_build(d, d->size, &len);
+  if (!img)
+  {
+    return -1;
+  }
+
+  /* Replace rather than rewrite: mappings of the old object stay intact */
+  shm_unlink(name);
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0)
+  {
+    error_callback("%s: shm_open(%s) failed\n", __func__, name);
+    free(img);
+    return -1;
+  }
+  if (ftruncate(fd, (off_t)len) != 0)
+  {
+    error_callback("%s: ftruncate() failed\n", __func__);
+    close(fd);
+    shm_unlink(name);
+    free(img);
+    return -1;
+  }
+  unsigned char *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    error_callback("%s: mmap() failed\n", __func__);
+    shm_unlink(name);
+    free(img);
+    return -1;
+  }
+
+  /* The magic is released last: a reader that opens the object early sees
+   * a zero-filled header and rejects it instead of reading a partial body */
+  uint64_t magic;
+  memcpy(&magic, img, sizeof(magic));
+  memcpy(map + sizeof(magic), img + sizeof(magic), len - sizeof(magic));
+  __atomic_store_n((uint64_t *)map, magic, __ATOMIC_RELEASE);
+  munmap(map, len);
+  free(img);
+  return 0;
+}
+
+struct dictionary *dictionary_shm_open(const char *name)
+{
+  if (!name)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return NULL;
+  }
+
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0)
+  {
+    error_callback("%s: shm_open(%s) failed\n", __func__, name);
+    return NULL;
+  }
+  return image_map_fd(fd, name);
+}
+
+int dictionary_shm_unlink(const char *name)
+{
+  if (!name)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return -1;
+  }
+  return shm_unlink(name) == 0 ? 0 : -1;
+}
+
+/* Header-only validation: O(1) regardless of image size */
+struct dictionary *dict_image_view(const void *img, size_t len)
+{
+  const struct dict_image_header *h = img;
+
+  if (len < sizeof(*h) ||
+      memcmp(h->magic, DICT_IMAGE_MAGIC, sizeof(DICT_IMAGE_MAGIC)) != 0 ||
+      h->version != DICT_IMAGE_VERSION ||
+      h->byteorder != DICT_IMAGE_BYTEORDER || h->nbuckets == 0 ||
+      dict_image_size(h) != len ||
+      (h->strsize && DICT_IMAGE_STRINGS(h)[h->strsize - 1] != '\0'))
+  {
+    error_callback("%s: not a valid dictionary image\n", __func__);
+    return NULL;
+  }
+
+  DICT_STAT(allocs);
+  struct dictionary *d = calloc(1, sizeof(struct dictionary));
+  if (!d)
+  {
+    error_callback("%s: calloc() failed\n", __func__);
+    return NULL;
+  }
+  d->image = h;
+  d->size = h->nbuckets;
+  d->numOfElements = h->nentries;
+  return d;
+}
+
+int dictionary_save_binary(const struct dictionary *d, FILE *out)
+{
+  if (!d || !out)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return -1;
+  }
+
+  size_t len;
+  void *img = dict_image_build(d, d->size, &len);
+  if (!img)
+  {
+    return -1;
+  }
+
+  int ret = 0;
+  if (fwrite(img, 1, len, out) != len)
+  {
+    error_callback("%s: fwrite() failed\n", __func__);
+    ret = -1;
+  }
+  free(img);
+  return ret;
+}
+
+struct dictionary *dictionary_load_binary(FILE *in)
+{
+  if (!in)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return NULL;
+  }
+
+  struct dict_image_header h;
+  if (fread(&h, sizeof(h), 1, in) != 1 ||
+      memcmp(h.magic, DICT_IMAGE_MAGIC, sizeof(DICT_IMAGE_MAGIC)) != 0 ||
+      h.nbuckets == 0)
+  {
+    error_callback("%s: not a dictionary image\n", __func__);
+    return NULL;
+  }
+  size_t len = dict_image_size(&h);
+  if (len == 0)
+  {
+    error_callback("%s: image too large\n", __func__);
+    return NULL;
+  }
+
+  struct dictionary *d = dictionary_new_sized(h.nbuckets);
+  if (!d)
+  {
+    return NULL;
+  }
+
+  /* The image stays resident; buckets point straight into its strings */
+  unsigned char *img = dictionary_chunk_alloc(d, len);
+  if (!img)
+  {
+    dictionary_del(d);
+    return NULL;
+  }
+  memcpy(img, &h, sizeof(h));
+  if (fread(img + sizeof(h), 1, len - sizeof(h), in) != len - sizeof(h))
+  {
+    error_callback("%s: truncated image\n", __func__);
+    dictionary_del(d);
+    return NULL;
+  }
+  if (dict_image_check(img, len) != 0)
+  {
+    dictionary_del(d);
+    return NULL;
+  }
+
+  const struct dict_image_header *hp = (const struct dict_image_header *)img;
+  const uint32_t *heads = DICT_IMAGE_HEADS(hp);
+  const struct dict_image_entry *entries = DICT_IMAGE_ENTRIES(hp);
+  char *strings = (char *)DICT_IMAGE_STRINGS(hp);
+
+  struct bucket *buckets = NULL;
+  if (h.nentries)
+  {
+    buckets = dictionary_chunk_alloc(d, h.nentries * sizeof(struct bucket));
+    if (!buckets)
+    {
+      dictionary_del(d);
+      return NULL;
+    }
+  }
+
+  for (uint32_t i = 0; i < h.nentries; i++)
+  {
+    struct bucket *b = &buckets[i];
+    b->key = strings + entries[i].key;
+    b->value =
+        entries[i].value == DICT_IMAGE_NONE ? NULL : strings + entries[i].value;
+    b->vbuf = b->val_buf;
+    b->vcap = sizeof(b->val_buf);
+    b->hash = entries[i].hash;
+    b->flags = BUCKET_KEY_BORROWED | BUCKET_IN_CHUNK;
+    b->ctag = BUCKET_CACHE_EMPTY;
+    if (h.ngroups)
+    {
+      /* Placed by the perfect hash: the table needs hash % size chains */
+      b->next = d->table[b->hash % h.nbuckets];
+      d->table[b->hash % h.nbuckets] = b;
+    }
+    else
+    {
+      b->next = entries[i].next ? &buckets[entries[i].next - 1] : NULL;
+    }
+  }
+  for (uint32_t i = 0; !h.ngroups && i < h.nbuckets; i++)
+  {
+    d->table[i] = heads[i] ? &buckets[heads[i] - 1] : NULL;
+  }
+  d->numOfElements = h.nentries;
+
+  return d;
+}
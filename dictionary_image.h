@@ -0,0 +1,79 @@
+#ifndef _DICTIONARY_IMAGE_H_
+#define _DICTIONARY_IMAGE_H_
+
+/* On-disk / in-memory image of a dictionary, as written by
+ * dictionary_save_binary(). Everything is addressed by 32-bit offsets so the
+ * same bytes can be used straight from a file or memory map.
+ *
+ *   struct dict_image_header
+ *   uint32_t                groups[ngroups]     seeds of a perfect hash index
+ *   uint32_t                heads[nbuckets]     entry index + 1, 0 = empty
+ *   struct dict_image_entry entries[nentries]   chains are contiguous
+ *   char                    strings[strsize]    NUL-terminated keys/values
+ *
+ * An entry is in the chain of slot dict_image_slot(): hash % nbuckets when
+ * ngroups is 0. Otherwise the keys are split into groups by hash % ngroups,
+ * and the seed of each group sends its keys to slots of their own, so the
+ * chains only hold keys with the same 32-bit hash.
+ *
+ * The checksum (32-bit FNV-1a) covers everything after the header. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dictionary.h"
+
+#define DICT_IMAGE_MAGIC "DICTIMG"
+#define DICT_IMAGE_VERSION 2
+#define DICT_IMAGE_BYTEORDER 0x01020304u
+#define DICT_IMAGE_NONE 0xffffffffu
+
+struct dict_image_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteorder;
+	uint32_t nbuckets;
+	uint32_t ngroups;
+	uint32_t nentries;
+	uint32_t strsize;
+	uint32_t checksum;
+};
+
+struct dict_image_entry {
+	uint32_t hash;
+	uint32_t key;
+	uint32_t value; /* DICT_IMAGE_NONE for a NULL value */
+	uint32_t next;  /* index + 1 of the next entry in the chain, 0 ends it */
+};
+
+#define DICT_IMAGE_GROUPS(h) ((const uint32_t *)((h) + 1))
+#define DICT_IMAGE_HEADS(h) (DICT_IMAGE_GROUPS(h) + (h)->ngroups)
+#define DICT_IMAGE_ENTRIES(h)                                                  \
+	((const struct dict_image_entry *)(DICT_IMAGE_HEADS(h) + (h)->nbuckets))
+#define DICT_IMAGE_STRINGS(h)                                                  \
+	((const char *)(DICT_IMAGE_ENTRIES(h) + (h)->nentries))
+
+size_t dict_image_size(const struct dict_image_header *h);
+void *dict_image_build(const struct dictionary *d, unsigned int nbuckets,
+											 size_t *len);
+/* Image with a perfect hash index over about one bucket per key: every key
+ * has a slot of its own, so a lookup is a single probe. */
+void *dict_image_build_perfect(const struct dictionary *d, size_t *len);
+uint32_t dict_image_slot(const struct dict_image_header *h, unsigned int hash);
+int dict_image_check(const void *img, size_t len);
+const char *dict_image_get(const struct dict_image_header *h, const char *key,
+													 unsigned int hash, const char *def);
+int dict_image_entry(const struct dict_image_header *h, uint32_t i,
+										 const char **key, const char **val);
+struct dictionary *dict_image_view(const void *img, size_t len);
+void dict_image_unmap(const struct dict_image_header *h, size_t maplen);
+
+/* Initializer for a read-only dictionary over an image compiled into the
+ * program (see tools/iniembed.c); nbuckets and nentries repeat the header
+ * fields as constants. Such a dictionary lives in static storage and must
+ * not be passed to dictionary_del(). */
+#define DICT_IMAGE_STATIC(h, nbuckets, nentries)                               \
+	{                                                                            \
+		.numOfElements = (nentries), .size = (nbuckets), .image = (h)              \
+	}
+
+#endif
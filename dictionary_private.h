@@ -0,0 +1,60 @@
+#ifndef _DICTIONARY_PRIVATE_H_
+#define _DICTIONARY_PRIVATE_H_
+
+/* Internals shared between the dictionary translation units. Not part of
+ * the public interface. */
+
+#include "dictionary.h"
+
+/* bucket->flags */
+#define BUCKET_VAL_INTERNED 0x01 /* value is a reference into d->pool */
+#define BUCKET_KEY_BORROWED 0x02 /* key lives in a chunk, not on the heap */
+#define BUCKET_IN_CHUNK 0x04     /* the bucket itself lives in a chunk */
+#define BUCKET_TOMBSTONE 0x08    /* overlay: key removed from the layers below */
+
+/* bucket->ctag: a typed conversion of the value cached in bucket->cbits.
+ * The tag only moves EMPTY -> BUSY -> <type> between two mutations, so
+ * concurrent readers can fill and use it without locking. */
+#define BUCKET_CACHE_EMPTY 0
+#define BUCKET_CACHE_BUSY 1
+#define BUCKET_CACHE_LONG 2
+#define BUCKET_CACHE_INT64 3
+#define BUCKET_CACHE_UINT64 4
+#define BUCKET_CACHE_DOUBLE 5
+#define BUCKET_CACHE_BOOL 6
+
+/* A block of memory released together with the dictionary owning it. */
+struct dict_chunk {
+	struct dict_chunk *next;
+	size_t size;
+};
+
+/* An object the dictionary keeps alive, released after its entries. */
+struct dict_hold {
+	struct dict_hold *next;
+	void (*release)(void *obj);
+	void *obj;
+};
+
+struct dictionary *dictionary_new_sized(unsigned int size);
+void *dictionary_chunk_alloc(struct dictionary *d, size_t size);
+/* Like dictionary_set() without copying: key and val must stay valid and
+ * unchanged as long as d does, usually through dictionary_hold(). */
+int dictionary_set_borrowed(struct dictionary *d, const char *key,
+														const char *val);
+/* dictionary_watch.c: called when key was added, changed or removed */
+void dict_watch_changed(struct dictionary *d, const char *key);
+void dict_watch_free(struct dict_watchers *ws);
+int dictionary_hold(struct dictionary *d, void (*release)(void *obj),
+										void *obj);
+
+/* Table-backed dictionaries only: NULL for a missing key, an image or an
+ * overlay */
+struct bucket *dictionary_find(const struct dictionary *d, const char *key);
+struct bucket *dictionary_find_hashed(const struct dictionary *d,
+																			const char *key, unsigned int hash);
+int bucket_cache_load(const struct bucket *b, unsigned char tag,
+											uint64_t *bits);
+void bucket_cache_store(struct bucket *b, unsigned char tag, uint64_t bits);
+
+#endif
@@ -0,0 +1,147 @@
+#include "dictionary.h"
+#include "dictionary_stats.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+/* A published dictionary, shared by the root and the snapshots taken of it.
+ * snap must stay first: dict_snapshot_release() casts back to the version. */
+struct dict_version
+{
+  struct dict_snapshot snap;
+  int refs;
+};
+
+/* Readers take a reference on the current version without locking: between
+ * loading cur and bumping its count they are registered in
+ * readers[epoch & 1], and only load cur once epoch is seen unchanged after
+ * registering. After swapping cur, a publisher flips epoch and waits
+ * for the readers of the previous parity to be done before dropping the
+ * root's reference on the old version. Readers arriving meanwhile use the
+ * other parity and already see the new version, so they cannot starve it. */
+struct dict_root
+{
+  struct dict_version *cur;
+  unsigned int epoch;
+  unsigned int readers[2];
+  pthread_mutex_t publish;
+};
+
+static struct dict_version *version_new(struct dictionary *d)
+{
+  DICT_STAT(allocs);
+  struct dict_version *v = malloc(sizeof(struct dict_version));
+  if (!v)
+  {
+    error_callback("%s: malloc() failed\n", __func__);
+    return NULL;
+  }
+  v->snap.dict = d;
+  v->refs = 1;
+  return v;
+}
+
+static void version_unref(struct dict_version *v)
+{
+  if (__atomic_sub_fetch(&v->refs, 1, __ATOMIC_ACQ_REL) == 0)
+  {
+    dictionary_del((struct dictionary *)v->snap.dict);
+    free(v);
+  }
+}
+
+struct dict_root *dict_root_new(struct dictionary *d)
+{
+  if (!d)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return NULL;
+  }
+
+  DICT_STAT(allocs);
+  struct dict_root *r = malloc(sizeof(struct dict_root));
+  if (!r)
+  {
+    error_callback("%s: malloc() failed\n", __func__);
+    return NULL;
+  }
+  r->cur = version_new(d);
+  if (!r->cur)
+  {
+    free(r);
+    return NULL;
+  }
+  r->epoch = 0;
+  r->readers[0] = 0;
+  r->readers[1] = 0;
+  pthread_mutex_init(&r->publish, NULL);
+  return r;
+}
+
+int dict_root_publish(struct dict_root *r, struct dictionary *d)
+{
+  if (!r || !d)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return -1;
+  }
+
+  struct dict_version *v = version_new(d);
+  if (!v)
+  {
+    return -1;
+  }
+
+  pthread_mutex_lock(&r->publish);
+  struct dict_version *old = __atomic_exchange_n(&r->cur, v, __ATOMIC_SEQ_CST);
+  unsigned int e = __atomic_fetch_add(&r->epoch, 1, __ATOMIC_SEQ_CST) & 1;
+  while (__atomic_load_n(&r->readers[e], __ATOMIC_ACQUIRE))
+  {
+    sched_yield();
+  }
+  pthread_mutex_unlock(&r->publish);
+
+  version_unref(old);
+  return 0;
+}
+
+void dict_root_del(struct dict_root *r)
+{
+  if (!r)
+  {
+    return;
+  }
+  version_unref(r->cur);
+  pthread_mutex_destroy(&r->publish);
+  free(r);
+}
+
+struct dict_snapshot *dict_snapshot_acquire(struct dict_root *r)
+{
+  unsigned int e = __atomic_load_n(&r->epoch, __ATOMIC_SEQ_CST);
+  for (;;)
+  {
+    __atomic_add_fetch(&r->readers[e & 1], 1, __ATOMIC_SEQ_CST);
+    unsigned int now = __atomic_load_n(&r->epoch, __ATOMIC_SEQ_CST);
+    if (now == e)
+    {
+      break;
+    }
+    /* A publish ran before we registered: the parity it left may already
+     * have been waited for by the next one */
+    __atomic_sub_fetch(&r->readers[e & 1], 1, __ATOMIC_RELEASE);
+    e = now;
+  }
+  struct dict_version *v = __atomic_load_n(&r->cur, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&v->refs, 1, __ATOMIC_RELAXED);
+  __atomic_sub_fetch(&r->readers[e & 1], 1, __ATOMIC_RELEASE);
+  return &v->snap;
+}
+
+void dict_snapshot_release(struct dict_snapshot *s)
+{
+  if (s)
+  {
+    version_unref((struct dict_version *)s);
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef _DICTIONARY_STATS_H_
+#define _DICTIONARY_STATS_H_
+
+/* Internal instrumentation macros shared by dictionary.c and iniparser.c.
+ * Everything here expands to nothing unless DICTIONARY_STATS is defined. */
+
+#include "dictionary.h"
+
+#ifdef DICTIONARY_STATS
+
+extern _Thread_local struct dictionary_stats dictionary_tls_stats;
+extern void (*dictionary_trace_begin)(const char *, const void *);
+extern void (*dictionary_trace_end)(const char *, const void *);
+
+#define DICT_STAT(field) (dictionary_tls_stats.field++)
+#define DICT_TRACE_BEGIN(name, obj)                                            \
+  do                                                                           \
+  {                                                                            \
+    if (dictionary_trace_begin)                                                \
+      dictionary_trace_begin((name), (obj));                                   \
+  } while (0)
+#define DICT_TRACE_END(name, obj)                                              \
+  do                                                                           \
+  {                                                                            \
+    if (dictionary_trace_end)                                                  \
+      dictionary_trace_end((name), (obj));                                     \
+  } while (0)
+
+#else
+
+#define DICT_STAT(field) ((void)0)
+#define DICT_TRACE_BEGIN(name, obj) ((void)0)
+#define DICT_TRACE_END(name, obj) ((void)0)
+
+#endif
+
+#endif
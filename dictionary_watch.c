@@ -0,0 +1,253 @@
+#include "dictionary.h"
+#include "dictionary_private.h"
+#include "dictionary_stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct dict_watch
+{
+  struct dict_watch *next;
+  int id;
+  dictionary_watch_cb cb; /* NULL once unwatched, until dead */
+  void *ctx;
+  size_t plen;
+  char prefix[];
+};
+
+/* depth counts open batches plus a delivery in progress: changes are only
+ * collected in pending while it is non-zero. */
+struct dict_watchers
+{
+  struct dict_watch *list;
+  int next_id;
+  int depth;
+  int dead;
+  struct dictionary *pending;
+};
+
+static int key_cmp(const void *a, const void *b)
+{
+  return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static int watch_matches(const struct dict_watch *w, const char *key)
+{
+  return w->cb && strncmp(key, w->prefix, w->plen) == 0;
+}
+
+static void watchers_sweep(struct dict_watchers *ws)
+{
+  struct dict_watch **link = &ws->list;
+  while (*link)
+  {
+    struct dict_watch *w = *link;
+    if (w->cb)
+    {
+      link = &w->next;
+      continue;
+    }
+    *link = w->next;
+    free(w);
+  }
+  ws->dead = 0;
+}
+
+/* Hands out the pending keys, in rounds while callbacks change d again */
+static void watchers_deliver(struct dictionary *d)
+{
+  struct dict_watchers *ws = d->watch;
+
+  ws->depth++;
+  while (ws->pending && ws->pending->numOfElements)
+  {
+    struct dictionary *batch = ws->pending;
+    ws->pending = NULL;
+
+    size_t n = batch->numOfElements;
+    const char **keys = malloc(2 * n * sizeof(*keys));
+    if (!keys)
+    {
+      error_callback("%s: malloc() failed\n", __func__);
+      dictionary_del(batch);
+      break;
+    }
+    const char **sel = keys + n;
+    struct dictionary_iter it;
+    const char *key;
+    const char *val;
+    size_t i = 0;
+    dictionary_iter_init(&it, batch);
+    while (dictionary_iter_next(&it, &key, &val))
+    {
+      keys[i++] = key;
+    }
+    qsort(keys, n, sizeof(*keys), key_cmp);
+
+    /* Watches added by a callback are at the head: they only see later rounds */
+    for (struct dict_watch *w = ws->list; w; w = w->next)
+    {
+      size_t m = 0;
+      for (i = 0; i < n; i++)
+      {
+        if (watch_matches(w, keys[i]))
+        {
+          sel[m++] = keys[i];
+        }
+      }
+      if (m)
+      {
+        w->cb(d, sel, m, w->ctx);
+      }
+    }
+    free(keys);
+    dictionary_del(batch);
+  }
+  ws->depth--;
+  if (ws->depth == 0 && ws->dead)
+  {
+    watchers_sweep(ws);
+  }
+}
+
+void dict_watch_changed(struct dictionary *d, const char *key)
+{
+  struct dict_watchers *ws = d->watch;
+  struct dict_watch *w = ws->list;
+  while (w && !watch_matches(w, key))
+  {
+    w = w->next;
+  }
+  if (!w)
+  {
+    return;
+  }
+
+  if (!ws->pending)
+  {
+    ws->pending = dictionary_new(0);
+  }
+  if (!ws->pending || dictionary_set(ws->pending, key, NULL) != 0)
+  {
+    error_callback("%s: change of %s not delivered\n", __func__, key);
+    return;
+  }
+  if (ws->depth == 0)
+  {
+    watchers_deliver(d);
+  }
+}
+
+void dict_watch_free(struct dict_watchers *ws)
+{
+  while (ws->list)
+  {
+    struct dict_watch *next = ws->list->next;
+    free(ws->list);
+    ws->list = next;
+  }
+  if (ws->pending)
+  {
+    dictionary_del(ws->pending);
+  }
+  free(ws);
+}
+
+int dictionary_watch(struct dictionary *d, const char *prefix,
+                     dictionary_watch_cb cb, void *ctx)
+{
+  if (!d || !prefix || !cb)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return -1;
+  }
+
+  if (d->image)
+  {
+    error_callback("%s: read-only dictionary\n", __func__);
+    return -1;
+  }
+
+  if (!d->watch)
+  {
+    DICT_STAT(allocs);
+    d->watch = calloc(1, sizeof(struct dict_watchers));
+    if (!d->watch)
+    {
+      error_callback("%s: malloc() failed\n", __func__);
+      return -1;
+    }
+  }
+
+  size_t plen = strlen(prefix);
+  DICT_STAT(allocs);
+  struct dict_watch *w = malloc(sizeof(struct dict_watch) + plen + 1);
+  if (!w)
+  {
+    error_callback("%s: malloc() failed\n", __func__);
+    return -1;
+  }
+  memcpy(w->prefix, prefix, plen + 1);
+  w->plen = plen;
+  w->cb = cb;
+  w->ctx = ctx;
+  w->id = ++d->watch->next_id;
+  w->next = d->watch->list;
+  d->watch->list = w;
+  return w->id;
+}
+
+int dictionary_unwatch(struct dictionary *d, int id)
+{
+  if (!d || !d->watch)
+  {
+    error_callback("%s: invalid input\n", __func__);
+    return -1;
+  }
+
+  for (struct dict_watch *w = d->watch->list; w; w = w->next)
+  {
+    if (w->id == id && w->cb)
+    {
+      /* Unlinked later if a delivery may be walking the list */
+      w->cb = NULL;
+      d->watch->dead = 1;
+      if (d->watch->depth == 0)
+      {
+        watchers_sweep(d->watch);
+      }
+      return 0;
+    }
+  }
+  return -1;
+}
+
+void dictionary_batch_begin(struct dictionary *d)
+{
+  if (!d || d->image)
+  {
+    return;
+  }
+  if (!d->watch)
+  {
+    DICT_STAT(allocs);
+    d->watch = calloc(1, sizeof(struct dict_watchers));
+    if (!d->watch)
+    {
+      error_callback("%s: malloc() failed\n", __func__);
+      return;
+    }
+  }
+  d->watch->depth++;
+}
+
+void dictionary_batch_end(struct dictionary *d)
+{
+  if (!d || !d->watch || d->watch->depth == 0)
+  {
+    return;
+  }
+  if (--d->watch->depth == 0)
+  {
+    watchers_deliver(d);
+  }
+}
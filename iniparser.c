@@ -7,12 +7,26 @@
 */
 /*--------------------------------------------------------------------------*/
 /*---------------------------- Includes ------------------------------------*/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* strtod_l(), newlocale() */
+#endif
 #include <ctype.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <inttypes.h>
+#include <float.h>
+#include <limits.h>
+#include <locale.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include "iniparser.h"
+#include "dictionary_private.h"
+#include "iniparser_private.h"
+#include "dictionary_stats.h"
 
 /*---------------------------- Defines -------------------------------------*/
 #define ASCIILINESZ (1024)
@@ -118,6 +132,296 @@ static unsigned strstrip(char *s)
     return last - s;
 }
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Locale-independent whitespace test matching the "C" locale.
+ */
+/*--------------------------------------------------------------------------*/
+static int num_isspace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static int num_digit(char c, int base)
+{
+    int v;
+
+    if (c >= '0' && c <= '9')
+        v = c - '0';
+    else if (c >= 'a' && c <= 'f')
+        v = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+        v = c - 'A' + 10;
+    else
+        return -1;
+    return v < base ? v : -1;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Parse an integer magnitude with C base prefixes.
+  @param    s       String to parse.
+  @param    end     Output: first character not consumed (may be NULL).
+  @param    mag     Output: absolute value, saturated to UINT64_MAX.
+  @param    neg     Output: 1 if a minus sign was present.
+  @return   0 if Ok, -1 if no digits were found, 1 on overflow.
+
+  Follows the strtol(s, &end, 0) grammar: leading white space, an optional
+  sign, then "0x"/"0X" for hexadecimal, a leading "0" for octal, decimal
+  otherwise. Unlike strtol() it never looks at the current locale.
+ */
+/*--------------------------------------------------------------------------*/
+static int num_parse_u64(const char *s, const char **end, uint64_t *mag, int *neg)
+{
+    const char *p = s;
+    const char *digits;
+    uint64_t v = 0;
+    int base = 10;
+    int overflow = 0;
+    int d;
+
+    while (num_isspace(*p))
+        p++;
+    *neg = 0;
+    if (*p == '+' || *p == '-')
+        *neg = (*p++ == '-');
+
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && num_digit(p[2], 16) >= 0)
+    {
+        base = 16;
+        p += 2;
+    }
+    else if (p[0] == '0')
+    {
+        base = 8;
+    }
+
+    digits = p;
+    while ((d = num_digit(*p, base)) >= 0)
+    {
+        if (v > (UINT64_MAX - (uint64_t)d) / (uint64_t)base)
+            overflow = 1;
+        else
+            v = v * (uint64_t)base + (uint64_t)d;
+        p++;
+    }
+
+    if (p == digits)
+    {
+        if (end)
+            *end = s;
+        *mag = 0;
+        return -1;
+    }
+    if (end)
+        *end = p;
+    *mag = overflow ? UINT64_MAX : v;
+    return overflow;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Convert a parsed magnitude to a signed value in [min, max].
+  @return   0 if Ok, 1 if the value had to be clamped.
+ */
+/*--------------------------------------------------------------------------*/
+static int num_to_signed(uint64_t mag, int neg, int overflow, int64_t min, int64_t max,
+                         int64_t *out)
+{
+    if (neg)
+    {
+        if (overflow || mag > (uint64_t)max + 1)
+        {
+            *out = min;
+            return 1;
+        }
+        *out = mag == (uint64_t)max + 1 ? min : -(int64_t)mag;
+        return 0;
+    }
+    if (overflow || mag > (uint64_t)max)
+    {
+        *out = max;
+        return 1;
+    }
+    *out = (int64_t)mag;
+    return 0;
+}
+
+/* Exact powers of ten representable in a double */
+static const double num_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static locale_t num_c_locale;
+static pthread_once_t num_c_locale_once = PTHREAD_ONCE_INIT;
+
+static void num_c_locale_init(void)
+{
+    num_c_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Parse a floating point number independently of the locale.
+  @param    s       String to parse.
+  @param    end     Output: first character not consumed (may be NULL).
+  @return   The parsed value, 0.0 if no number was found.
+
+  Decimal numbers whose significand fits in 53 bits and whose decimal
+  exponent is small enough are converted with a single exactly rounded
+  multiplication or division (Clinger's fast path), which covers nearly
+  every value found in configuration files. Anything else (long
+  significands, huge exponents, hex floats, inf, nan) is handed to
+  strtod_l() with a "C" numeric locale created once, so the result is
+  correctly rounded, always uses '.' as the decimal point and does not
+  touch the thread-unsafe global locale state.
+ */
+/*--------------------------------------------------------------------------*/
+static double num_parse_double(const char *s, const char **end)
+{
+    const char *p = s;
+    const char *start;
+    const char *digits;
+    uint64_t mant = 0;
+    int ndigits = 0;
+    int exp10 = 0;
+    int exact = 1;
+    int neg = 0;
+
+    while (num_isspace(*p))
+        p++;
+    start = p;
+    if (*p == '+' || *p == '-')
+        neg = (*p++ == '-');
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+        goto slow;
+
+    digits = p;
+    for (; *p >= '0' && *p <= '9'; p++)
+    {
+        if (ndigits < 19)
+        {
+            if (mant || *p != '0')
+            {
+                mant = mant * 10 + (uint64_t)(*p - '0');
+                ndigits++;
+            }
+        }
+        else
+        {
+            exp10++;
+            exact &= (*p == '0');
+        }
+    }
+    if (*p == '.')
+    {
+        p++;
+        for (; *p >= '0' && *p <= '9'; p++)
+        {
+            if (ndigits < 19)
+            {
+                if (mant || *p != '0')
+                {
+                    mant = mant * 10 + (uint64_t)(*p - '0');
+                    ndigits++;
+                }
+                exp10--;
+            }
+            else
+            {
+                exact &= (*p == '0');
+            }
+        }
+    }
+    if (p == digits || (p == digits + 1 && *digits == '.'))
+    {
+        /* No digits at all: maybe inf/nan, otherwise not a number */
+        goto slow;
+    }
+    if ((*p == 'e' || *p == 'E') &&
+        ((p[1] >= '0' && p[1] <= '9') ||
+         ((p[1] == '+' || p[1] == '-') && p[2] >= '0' && p[2] <= '9')))
+    {
+        int eneg = 0;
+        int e = 0;
+
+        p++;
+        if (*p == '+' || *p == '-')
+            eneg = (*p++ == '-');
+        for (; *p >= '0' && *p <= '9'; p++)
+        {
+            if (e < 100000)
+                e = e * 10 + (*p - '0');
+        }
+        exp10 += eneg ? -e : e;
+    }
+
+#if FLT_EVAL_METHOD == 0
+    if (exact && mant <= ((uint64_t)1 << 53))
+    {
+        double v = (double)mant;
+
+        if (mant == 0 || exp10 == 0)
+            goto done;
+        if (exp10 < 0 && exp10 >= -22)
+        {
+            v /= num_pow10[-exp10];
+            goto done;
+        }
+        if (exp10 > 0 && exp10 <= 22 + 15)
+        {
+            /* Move surplus powers into the significand while it stays exact */
+            if (exp10 > 22)
+            {
+                double m = v * num_pow10[exp10 - 22];
+                if (m > 9007199254740992.0)
+                    goto slow;
+                v = m;
+                exp10 = 22;
+            }
+            v *= num_pow10[exp10];
+            goto done;
+        }
+        goto slow;
+done:
+        if (end)
+            *end = p;
+        return neg ? -v : v;
+    }
+#endif
+
+slow:
+    {
+        char *bend;
+        double v;
+
+        pthread_once(&num_c_locale_once, num_c_locale_init);
+        if (!num_c_locale)
+        {
+            /* newlocale() failed: report no number rather than guess */
+            if (end)
+                *end = s;
+            return 0.0;
+        }
+        v = strtod_l(start, &bend, num_c_locale);
+        if (end)
+            *end = bend == start ? s : bend;
+        return v;
+    }
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Tell whether only white space is left after a parsed number.
+ */
+/*--------------------------------------------------------------------------*/
+static int num_trailing_ok(const char *p)
+{
+    while (num_isspace(*p))
+        p++;
+    return *p == '\0';
+}
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Default error callback for iniparser: wraps `fprintf(stderr, ...)`.
@@ -133,7 +437,7 @@ static int default_error_callback(const char *format, ...)
     return ret;
 }
 
-static int (*iniparser_error_callback)(const char *, ...) = default_error_callback;
+int (*iniparser_error_callback)(const char *, ...) = default_error_callback;
 
 /*-------------------------------------------------------------------------*/
 /**
@@ -179,17 +483,15 @@ int iniparser_getnsec(const struct dictionary *d)
     if (d == NULL)
         return -1;
     int nsec = 0;
+    struct dictionary_iter it;
+    const char *key, *val;
 
-    for (size_t i = 0; i < d->size; i++)
+    dictionary_iter_init(&it, d);
+    while (dictionary_iter_next(&it, &key, &val))
     {
-        struct bucket *curr = d->table[i];
-        while (curr)
+        if (strchr(key, ':') == NULL)
         {
-            if (strchr(curr->key, ':') == NULL)
-            {
-                nsec++;
-            }
-            curr = curr->next;
+            nsec++;
         }
     }
     return nsec;
@@ -217,21 +519,19 @@ const char *iniparser_getsecname(const struct dictionary *d, int n)
     }
 
     int foundsec = 0;
+    struct dictionary_iter it;
+    const char *key, *val;
 
-    for (size_t i = 0; i < d->size; i++)
+    dictionary_iter_init(&it, d);
+    while (dictionary_iter_next(&it, &key, &val))
     {
-        struct bucket *curr = d->table[i];
-        while (curr)
+        if (strchr(key, ':') == NULL)
         {
-            if (strchr(curr->key, ':') == NULL)
+            if (foundsec == n)
             {
-                if (foundsec == n)
-                {
-                    return curr->key; /* 第 n 個 section 找到了 */
-                }
-                foundsec++;
+                return key; /* 第 n 個 section 找到了 */
             }
-            curr = curr->next;
+            foundsec++;
         }
     }
     return NULL;
@@ -255,19 +555,20 @@ void iniparser_dump(const struct dictionary *d, FILE *f)
     if (d == NULL || f == NULL)
         return;
 
-    /* 逐 bucket → 逐節點掃描 */
-    for (unsigned int i = 0; i < d->size; i++) {
-        struct bucket *curr = d->table[i];
-        while (curr) {
-            fprintf(f, "[%s]=[%s]\n",
-                    curr->key,
-                    curr->value ? curr->value : "UNDEF");
-            curr = curr->next;
-        }
+    DICT_TRACE_BEGIN(__func__, d);
+    struct dictionary_iter it;
+    const char *key, *val;
+
+    dictionary_iter_init(&it, d);
+    while (dictionary_iter_next(&it, &key, &val)) {
+        fprintf(f, "[%s]=[%s]\n",
+                key,
+                val ? val : "UNDEF");
     }
+    DICT_TRACE_END(__func__, d);
 }
 
-static void escape_value(char *escaped, char *value)
+static void escape_value(char *escaped, const char *value)
 {
     char c;
     int v = 0;
@@ -306,6 +607,7 @@ void iniparser_dump_ini(const struct dictionary *d, FILE *f)
     if (d == NULL || f == NULL)
         return;
 
+    DICT_TRACE_BEGIN(__func__, d);
     size_t nsec = iniparser_getnsec(d);
     char   escaped[(ASCIILINESZ * 2) + 2] = "";
 
@@ -313,16 +615,17 @@ void iniparser_dump_ini(const struct dictionary *d, FILE *f)
     /*  沒有任何 section：直接列出所有「key = value」               */
     /*------------------------------------------------------------*/
     if (nsec < 1) {
-        for (size_t i = 0; i < d->size; i++) {
-            struct bucket *curr = d->table[i];
-            while (curr) {
-                escape_value(escaped, curr->value);
-                fprintf(f, "%s = \"%s\"\n",
-                        curr->key,
-                        escaped);
-                curr = curr->next;
-            }
+        struct dictionary_iter it;
+        const char *key, *val;
+
+        dictionary_iter_init(&it, d);
+        while (dictionary_iter_next(&it, &key, &val)) {
+            escape_value(escaped, val);
+            fprintf(f, "%s = \"%s\"\n",
+                    key,
+                    escaped);
         }
+        DICT_TRACE_END(__func__, d);
         return;
     }
 
@@ -334,6 +637,7 @@ void iniparser_dump_ini(const struct dictionary *d, FILE *f)
         iniparser_dumpsection_ini(d, secname, f);
     }
     fprintf(f, "\n");
+    DICT_TRACE_END(__func__, d);
 }
 
 /*-------------------------------------------------------------------------*/
@@ -354,6 +658,7 @@ void iniparser_dumpsection_ini(const struct dictionary *d, const char *s, FILE *
     if (!iniparser_find_entry(d, s)) return;
     if (strlen(s) >= ASCIILINESZ) return;
 
+    DICT_TRACE_BEGIN(__func__, d);
     /* section 標頭 */
     fprintf(f, "\n[%s]\n", s);
 
@@ -363,22 +668,22 @@ void iniparser_dumpsection_ini(const struct dictionary *d, const char *s, FILE *
     size_t prelen = strlen(prefix);
 
     char escaped[(ASCIILINESZ * 2) + 2] = "";
-
-    /* 逐 bucket → 逐節點掃描 */
-    for (size_t i = 0; i < d->size; i++) {
-        struct bucket *curr = d->table[i];
-        while (curr) {
-            /* 判斷是否屬於該 section */
-            if (strncmp(curr->key, prefix, prelen) == 0) {
-                escape_value(escaped, curr->value);   /* 跳脫字串中的 \ 與 " */
-                fprintf(f, "%-30s = \"%s\"\n",
-                        curr->key + prelen,           /* 冒號後面的部分 */
-                        escaped);
-            }
-            curr = curr->next;
+    struct dictionary_iter it;
+    const char *key, *val;
+
+    /* 逐筆掃描 */
+    dictionary_iter_init(&it, d);
+    while (dictionary_iter_next(&it, &key, &val)) {
+        /* 判斷是否屬於該 section */
+        if (strncmp(key, prefix, prelen) == 0) {
+            escape_value(escaped, val);   /* 跳脫字串中的 \ 與 " */
+            fprintf(f, "%-30s = \"%s\"\n",
+                    key + prelen,         /* 冒號後面的部分 */
+                    escaped);
         }
     }
     fprintf(f, "\n");
+    DICT_TRACE_END(__func__, d);
 }
 
 /*-------------------------------------------------------------------------*/
@@ -409,22 +714,19 @@ int iniparser_getsecnkeys(const struct dictionary *d, const char *s)
     keym[seclen + 1] = '\0';
 
     int nkeys = 0;
+    struct dictionary_iter it;
+    const char *key, *val;
 
-    /* 兩層迴圈：先掃每個 bucket，再沿鏈表 */
-    for (size_t i = 0; i < d->size; i++)
+    dictionary_iter_init(&it, d);
+    while (dictionary_iter_next(&it, &key, &val))
     {
-        struct bucket *curr = d->table[i];
-        while (curr)
+        /*
+         * 若 key 以 "section:" 為前綴就累計。
+         * seclen+1 因為包含 ':'。
+         */
+        if (!strncmp(key, keym, seclen + 1))
         {
-            /*
-             * 若 key 以 "section:" 為前綴就累計。
-             * seclen+1 因為包含 ':'。
-             */
-            if (!strncmp(curr->key, keym, seclen + 1))
-            {
-                nkeys++;
-            }
-            curr = curr->next;
+            nkeys++;
         }
     }
     return nkeys;
@@ -469,25 +771,92 @@ const char **iniparser_getseckeys(const struct dictionary *d,
     keym[seclen + 1] = '\0';
 
     int nk = 0; /* 寫入 keys[] 的索引 */
+    struct dictionary_iter it;
+    const char *key, *val;
 
-    /* 兩層：先掃 bucket 陣列，再沿鏈表 */
-    for (size_t i = 0; i < d->size; i++)
+    dictionary_iter_init(&it, d);
+    while (dictionary_iter_next(&it, &key, &val))
     {
-        struct bucket *curr = d->table[i];
-        while (curr)
+        /* 若以 "section:" 為前綴，就加入結果陣列 */
+        if (strncmp(key, keym, seclen + 1) == 0)
         {
-            /* 若以 "section:" 為前綴，就加入結果陣列 */
-            if (strncmp(curr->key, keym, seclen + 1) == 0)
-            {
-                keys[nk++] = curr->key; /* 直接存指標，不複製字串 */
-            }
-            curr = curr->next;
+            keys[nk++] = key; /* 直接存指標，不複製字串 */
         }
     }
 
     return (nk > 0) ? keys : NULL; /* 無鍵時回傳 NULL 與舊版一致 */
 }
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Per-thread cache of recent lookups, see iniparser_set_lookup_cache()
+
+  Direct-mapped on the address of the key string and of the dictionary. A
+  slot is only trusted while the dictionary still has the generation it
+  was filled at, which guarantees the entry is still in place, and when the
+  key string still names that entry.
+ */
+/*--------------------------------------------------------------------------*/
+#define INI_LOOKUP_CACHE_SIZE 32
+
+struct ini_lookup_slot
+{
+    const char *key;
+    const struct dictionary *d;
+    unsigned long gen;
+    struct bucket *b;
+};
+
+static _Thread_local int ini_lookup_cache_on;
+static _Thread_local struct ini_lookup_slot ini_lookup_cache[INI_LOOKUP_CACHE_SIZE];
+
+int iniparser_set_lookup_cache(int enable)
+{
+    int was = ini_lookup_cache_on;
+
+    memset(ini_lookup_cache, 0, sizeof(ini_lookup_cache));
+    ini_lookup_cache_on = enable != 0;
+    return was;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Find the entry of a key in a dictionary that has a table
+  @param    d       Dictionary to search, not an image or an overlay
+  @param    key     Key string to look for, in any case
+  @return   The entry, or NULL if the key cannot be found
+ */
+/*--------------------------------------------------------------------------*/
+static struct bucket *iniparser_lookup(const struct dictionary *d, const char *key)
+{
+    char tmp_str[ASCIILINESZ + 1];
+    struct ini_lookup_slot *s = NULL;
+    struct bucket *b;
+
+    if (ini_lookup_cache_on)
+    {
+        uintptr_t k = (uintptr_t)key ^ ((uintptr_t)d >> 4);
+
+        s = &ini_lookup_cache[(k ^ (k >> 5)) % INI_LOOKUP_CACHE_SIZE];
+        if (s->key == key && s->d == d && s->gen == d->generation &&
+            strcasecmp(s->b->key, key) == 0)
+        {
+            DICT_STAT(ini_cache_hits);
+            return s->b;
+        }
+    }
+    strlwc(key, tmp_str, sizeof(tmp_str));
+    b = dictionary_find(d, tmp_str);
+    if (s && b)
+    {
+        s->key = key;
+        s->d = d;
+        s->gen = d->generation;
+        s->b = b;
+    }
+    return b;
+}
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Get the string associated to a key
@@ -505,16 +874,175 @@ const char **iniparser_getseckeys(const struct dictionary *d,
 /*--------------------------------------------------------------------------*/
 const char *iniparser_getstring(const struct dictionary *d, const char *key, const char *def)
 {
-    const char *lc_key;
-    const char *sval;
     char tmp_str[ASCIILINESZ + 1];
+    struct bucket *b;
 
     if (d == NULL || key == NULL)
         return def;
 
-    lc_key = strlwc(key, tmp_str, sizeof(tmp_str));
-    sval = dictionary_get(d, lc_key, def);
-    return sval;
+    DICT_STAT(ini_lookups);
+    if (d->image || d->layers)
+        return dictionary_get(d, strlwc(key, tmp_str, sizeof(tmp_str)), def);
+    b = iniparser_lookup(d, key);
+    return b ? b->value : def;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Look up a key for one of the typed accessors
+  @param    d       Dictionary to search
+  @param    key     Key string to look for
+  @param    b       Output: the entry holding the value, if there is one
+  @return   The value, or INI_INVALID_KEY if the key cannot be found
+
+  Like iniparser_getstring(), but also hands back the dictionary entry so
+  the caller can reuse or record a typed conversion of the value. *b is
+  NULL for dictionaries served from a snapshot image and for overlays.
+ */
+/*--------------------------------------------------------------------------*/
+static const char *iniparser_getvalue(const struct dictionary *d, const char *key,
+                                      struct bucket **b)
+{
+    char tmp_str[ASCIILINESZ + 1];
+
+    *b = NULL;
+    if (d == NULL || key == NULL)
+        return INI_INVALID_KEY;
+
+    DICT_STAT(ini_lookups);
+    if (d->image || d->layers)
+        return dictionary_get(d, strlwc(key, tmp_str, sizeof(tmp_str)), INI_INVALID_KEY);
+    *b = iniparser_lookup(d, key);
+    return *b ? (*b)->value : INI_INVALID_KEY;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Convert a looked up value for the typed accessors
+  @param    str       Value returned by a lookup, or INI_INVALID_KEY
+  @param    b         Entry holding the value, NULL if there is none
+  @param    notfound  Value to return in case of error
+  @return   The converted value
+
+  These carry the conversion and the per-entry conversion cache shared by
+  the key based accessors and the iniparser_get*_h() handle accessors.
+ */
+/*--------------------------------------------------------------------------*/
+static long int iniparser_conv_longint(const char *str, struct bucket *b, long int notfound)
+{
+    uint64_t bits;
+    long int ret;
+
+    if (str == NULL || str == INI_INVALID_KEY)
+        return notfound;
+    if (b && bucket_cache_load(b, BUCKET_CACHE_LONG, &bits) == 0)
+        return (long int)bits;
+    DICT_STAT(ini_conversions);
+    {
+        uint64_t mag;
+        int neg;
+        int64_t v;
+        int ovf = num_parse_u64(str, NULL, &mag, &neg) > 0;
+        num_to_signed(mag, neg, ovf, LONG_MIN, LONG_MAX, &v);
+        ret = (long int)v;
+    }
+    if (b)
+        bucket_cache_store(b, BUCKET_CACHE_LONG, (uint64_t)ret);
+    return ret;
+}
+
+static int64_t iniparser_conv_int64(const char *str, struct bucket *b, int64_t notfound)
+{
+    uint64_t bits;
+    int64_t ret;
+
+    if (str == NULL || str == INI_INVALID_KEY)
+        return notfound;
+    if (b && bucket_cache_load(b, BUCKET_CACHE_INT64, &bits) == 0)
+        return (int64_t)bits;
+    DICT_STAT(ini_conversions);
+    {
+        uint64_t mag;
+        int neg;
+        int ovf = num_parse_u64(str, NULL, &mag, &neg) > 0;
+        num_to_signed(mag, neg, ovf, INT64_MIN, INT64_MAX, &ret);
+    }
+    if (b)
+        bucket_cache_store(b, BUCKET_CACHE_INT64, (uint64_t)ret);
+    return ret;
+}
+
+static uint64_t iniparser_conv_uint64(const char *str, struct bucket *b, uint64_t notfound)
+{
+    uint64_t bits;
+    uint64_t ret;
+
+    if (str == NULL || str == INI_INVALID_KEY)
+        return notfound;
+    if (b && bucket_cache_load(b, BUCKET_CACHE_UINT64, &bits) == 0)
+        return bits;
+    DICT_STAT(ini_conversions);
+    {
+        int neg;
+        /* Like strtoumax(): a minus sign negates in unsigned arithmetic */
+        if (num_parse_u64(str, NULL, &ret, &neg) > 0)
+            ret = UINT64_MAX;
+        else if (neg)
+            ret = (uint64_t)0 - ret;
+    }
+    if (b)
+        bucket_cache_store(b, BUCKET_CACHE_UINT64, ret);
+    return ret;
+}
+
+static double iniparser_conv_double(const char *str, struct bucket *b, double notfound)
+{
+    uint64_t bits;
+    double ret;
+
+    if (str == NULL || str == INI_INVALID_KEY)
+        return notfound;
+    if (b && bucket_cache_load(b, BUCKET_CACHE_DOUBLE, &bits) == 0)
+    {
+        memcpy(&ret, &bits, sizeof(ret));
+        return ret;
+    }
+    DICT_STAT(ini_conversions);
+    ret = num_parse_double(str, NULL);
+    if (b)
+    {
+        memcpy(&bits, &ret, sizeof(bits));
+        bucket_cache_store(b, BUCKET_CACHE_DOUBLE, bits);
+    }
+    return ret;
+}
+
+static int iniparser_conv_boolean(const char *c, struct bucket *b, int notfound)
+{
+    int ret;
+    uint64_t bits;
+
+    if (c == NULL || c == INI_INVALID_KEY)
+        return notfound;
+    if (b && bucket_cache_load(b, BUCKET_CACHE_BOOL, &bits) == 0)
+        return (int)bits;
+    DICT_STAT(ini_conversions);
+    if (c[0] == 'y' || c[0] == 'Y' || c[0] == '1' || c[0] == 't' || c[0] == 'T')
+    {
+        ret = 1;
+    }
+    else if (c[0] == 'n' || c[0] == 'N' || c[0] == '0' || c[0] == 'f' || c[0] == 'F')
+    {
+        ret = 0;
+    }
+    else
+    {
+        /* Not a boolean: nothing worth caching, notfound may differ */
+        return notfound;
+    }
+    if (b)
+        bucket_cache_store(b, BUCKET_CACHE_BOOL, (uint64_t)ret);
+    return ret;
 }
 
 /*-------------------------------------------------------------------------*/
@@ -537,41 +1065,43 @@ const char *iniparser_getstring(const struct dictionary *d, const char *key, con
   "042"     ->  34 (octal -> decimal)
   "0x42"    ->  66 (hexa  -> decimal)
 
-  Warning: the conversion may overflow in various ways. Conversion is
-  totally outsourced to strtol(), see the associated man page for overflow
-  handling.
-
-  Credits: Thanks to A. Becker for suggesting strtol()
+  Conversion uses a built-in parser that follows the strtol() rules but
+  ignores the locale. Out of range values saturate to LONG_MIN/LONG_MAX;
+  use iniparser_getlongint_checked() to detect them.
  */
 /*--------------------------------------------------------------------------*/
 long int iniparser_getlongint(const struct dictionary *d, const char *key, long int notfound)
 {
-    const char *str;
+    struct bucket *b;
+    const char *str = iniparser_getvalue(d, key, &b);
 
-    str = iniparser_getstring(d, key, INI_INVALID_KEY);
-    if (str == NULL || str == INI_INVALID_KEY)
-        return notfound;
-    return strtol(str, NULL, 0);
+    return iniparser_conv_longint(str, b, notfound);
 }
 
 int64_t iniparser_getint64(const struct dictionary *d, const char *key, int64_t notfound)
 {
-    const char *str;
+    struct bucket *b;
+    const char *str = iniparser_getvalue(d, key, &b);
 
-    str = iniparser_getstring(d, key, INI_INVALID_KEY);
-    if (str == NULL || str == INI_INVALID_KEY)
-        return notfound;
-    return strtoimax(str, NULL, 0);
+    return iniparser_conv_int64(str, b, notfound);
 }
 
 uint64_t iniparser_getuint64(const struct dictionary *d, const char *key, uint64_t notfound)
 {
-    const char *str;
+    struct bucket *b;
+    const char *str = iniparser_getvalue(d, key, &b);
 
-    str = iniparser_getstring(d, key, INI_INVALID_KEY);
-    if (str == NULL || str == INI_INVALID_KEY)
-        return notfound;
-    return strtoumax(str, NULL, 0);
+    return iniparser_conv_uint64(str, b, notfound);
+}
+
+/* Saturating, like the conversion of out of range strings */
+static int ini_long_to_int(long v)
+{
+    if (v > INT_MAX)
+        return INT_MAX;
+    if (v < INT_MIN)
+        return INT_MIN;
+    return (int)v;
 }
 
 /*-------------------------------------------------------------------------*/
@@ -594,16 +1124,14 @@ uint64_t iniparser_getuint64(const struct dictionary *d, const char *key, uint64
   "042"     ->  34 (octal -> decimal)
   "0x42"    ->  66 (hexa  -> decimal)
 
-  Warning: the conversion may overflow in various ways. Conversion is
-  totally outsourced to strtol(), see the associated man page for overflow
-  handling.
-
-  Credits: Thanks to A. Becker for suggesting strtol()
+  Conversion uses a built-in parser that follows the strtol() rules but
+  ignores the locale. Out of range values saturate to INT_MIN/INT_MAX;
+  use iniparser_getint_checked() to detect them.
  */
 /*--------------------------------------------------------------------------*/
 int iniparser_getint(const struct dictionary *d, const char *key, int notfound)
 {
-    return (int)iniparser_getlongint(d, key, notfound);
+    return ini_long_to_int(iniparser_getlongint(d, key, notfound));
 }
 
 /*-------------------------------------------------------------------------*/
@@ -621,25 +1149,234 @@ int iniparser_getint(const struct dictionary *d, const char *key, int notfound)
 /*--------------------------------------------------------------------------*/
 double iniparser_getdouble(const struct dictionary *d, const char *key, double notfound)
 {
-    const char *str;
+    struct bucket *b;
+    const char *str = iniparser_getvalue(d, key, &b);
 
-    str = iniparser_getstring(d, key, INI_INVALID_KEY);
-    if (str == NULL || str == INI_INVALID_KEY)
-        return notfound;
-    return atof(str);
+    return iniparser_conv_double(str, b, notfound);
 }
 
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Get the string associated to a key, convert to a boolean
-  @param    d Dictionary to search
-  @param    key Key string to look for
-  @param    notfound Value to return in case of error
-  @return   integer
-
-  This function queries a dictionary for a key. A key as read from an
-  ini file is given as "section:key". If the key cannot be found,
-  the notfound value is returned.
+  @brief    Strict conversions behind the checked accessors and
+            iniparser_bind().
+  @return   INIPARSER_OK, INIPARSER_ESYNTAX or INIPARSER_ERANGE
+ */
+/*--------------------------------------------------------------------------*/
+static int iniparser_check_signed(const char *str, int64_t min, int64_t max, int64_t *out)
+{
+    const char *end;
+    uint64_t mag;
+    int neg;
+    int ret;
+    int64_t v;
+
+    DICT_STAT(ini_conversions);
+    ret = num_parse_u64(str, &end, &mag, &neg);
+    if (ret < 0 || !num_trailing_ok(end))
+        return INIPARSER_ESYNTAX;
+    if (num_to_signed(mag, neg, ret, min, max, &v))
+        return INIPARSER_ERANGE;
+    *out = v;
+    return INIPARSER_OK;
+}
+
+static int iniparser_check_uint64(const char *str, uint64_t *out)
+{
+    const char *end;
+    uint64_t mag;
+    int neg;
+    int ret;
+
+    DICT_STAT(ini_conversions);
+    ret = num_parse_u64(str, &end, &mag, &neg);
+    if (ret < 0 || !num_trailing_ok(end))
+        return INIPARSER_ESYNTAX;
+    if (ret > 0 || (neg && mag != 0))
+        return INIPARSER_ERANGE;
+    *out = mag;
+    return INIPARSER_OK;
+}
+
+static int iniparser_check_double(const char *str, double *out)
+{
+    const char *end;
+    double v;
+
+    DICT_STAT(ini_conversions);
+    errno = 0;
+    v = num_parse_double(str, &end);
+    if (end == str || !num_trailing_ok(end))
+        return INIPARSER_ESYNTAX;
+    if (errno == ERANGE && (v == HUGE_VAL || v == -HUGE_VAL))
+        return INIPARSER_ERANGE;
+    *out = v;
+    return INIPARSER_OK;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Shared body of the checked signed integer accessors.
+ */
+/*--------------------------------------------------------------------------*/
+static int iniparser_getsigned_checked(const struct dictionary *d, const char *key,
+                                       int64_t min, int64_t max, int64_t *out)
+{
+    const char *str;
+
+    str = iniparser_getstring(d, key, INI_INVALID_KEY);
+    if (str == NULL || str == INI_INVALID_KEY)
+        return INIPARSER_ENOTFOUND;
+    return iniparser_check_signed(str, min, max, out);
+}
+
+int iniparser_getint_checked(const struct dictionary *d, const char *key, int *out)
+{
+    int64_t v;
+    int ret;
+
+    if (out == NULL)
+        return INIPARSER_ENOTFOUND;
+    ret = iniparser_getsigned_checked(d, key, INT_MIN, INT_MAX, &v);
+    if (ret == INIPARSER_OK)
+        *out = (int)v;
+    return ret;
+}
+
+int iniparser_getlongint_checked(const struct dictionary *d, const char *key, long int *out)
+{
+    int64_t v;
+    int ret;
+
+    if (out == NULL)
+        return INIPARSER_ENOTFOUND;
+    ret = iniparser_getsigned_checked(d, key, LONG_MIN, LONG_MAX, &v);
+    if (ret == INIPARSER_OK)
+        *out = (long int)v;
+    return ret;
+}
+
+int iniparser_getint64_checked(const struct dictionary *d, const char *key, int64_t *out)
+{
+    if (out == NULL)
+        return INIPARSER_ENOTFOUND;
+    return iniparser_getsigned_checked(d, key, INT64_MIN, INT64_MAX, out);
+}
+
+int iniparser_getuint64_checked(const struct dictionary *d, const char *key, uint64_t *out)
+{
+    const char *str;
+
+    if (out == NULL)
+        return INIPARSER_ENOTFOUND;
+    str = iniparser_getstring(d, key, INI_INVALID_KEY);
+    if (str == NULL || str == INI_INVALID_KEY)
+        return INIPARSER_ENOTFOUND;
+    return iniparser_check_uint64(str, out);
+}
+
+int iniparser_getdouble_checked(const struct dictionary *d, const char *key, double *out)
+{
+    const char *str;
+
+    if (out == NULL)
+        return INIPARSER_ENOTFOUND;
+    str = iniparser_getstring(d, key, INI_INVALID_KEY);
+    if (str == NULL || str == INI_INVALID_KEY)
+        return INIPARSER_ENOTFOUND;
+    return iniparser_check_double(str, out);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Convert one value for iniparser_bind() and store it in a field.
+ */
+/*--------------------------------------------------------------------------*/
+static int iniparser_bind_value(enum iniparser_type type, const char *str, void *field)
+{
+    int64_t i;
+    int ret;
+
+    switch (type)
+    {
+    case INIPARSER_TYPE_INT:
+        ret = iniparser_check_signed(str, INT_MIN, INT_MAX, &i);
+        if (ret == INIPARSER_OK)
+            *(int *)field = (int)i;
+        return ret;
+    case INIPARSER_TYPE_LONG:
+        ret = iniparser_check_signed(str, LONG_MIN, LONG_MAX, &i);
+        if (ret == INIPARSER_OK)
+            *(long int *)field = (long int)i;
+        return ret;
+    case INIPARSER_TYPE_INT64:
+        return iniparser_check_signed(str, INT64_MIN, INT64_MAX, (int64_t *)field);
+    case INIPARSER_TYPE_UINT64:
+        return iniparser_check_uint64(str, (uint64_t *)field);
+    case INIPARSER_TYPE_DOUBLE:
+        return iniparser_check_double(str, (double *)field);
+    case INIPARSER_TYPE_BOOL:
+        if (str[0] == 'y' || str[0] == 'Y' || str[0] == '1' || str[0] == 't' || str[0] == 'T')
+            *(int *)field = 1;
+        else if (str[0] == 'n' || str[0] == 'N' || str[0] == '0' || str[0] == 'f' || str[0] == 'F')
+            *(int *)field = 0;
+        else
+            return INIPARSER_ESYNTAX;
+        return INIPARSER_OK;
+    case INIPARSER_TYPE_STRING:
+        *(const char **)field = str;
+        return INIPARSER_OK;
+    }
+    return INIPARSER_ESYNTAX;
+}
+
+int iniparser_bind(const struct dictionary *d, const struct iniparser_binding *binding,
+                   size_t n, void *cfg)
+{
+    const struct iniparser_binding *b;
+    const char *str;
+    size_t i;
+    int first = INIPARSER_OK;
+    int ret;
+
+    if (d == NULL || binding == NULL || cfg == NULL)
+        return INIPARSER_ENOTFOUND;
+
+    for (i = 0; i < n; i++)
+    {
+        b = &binding[i];
+        str = dictionary_get(d, b->key, INI_INVALID_KEY);
+        if (str == NULL || str == INI_INVALID_KEY)
+            str = b->def;
+        if (str == NULL)
+        {
+            iniparser_error_callback("iniparser: %s: missing required key\n", b->key);
+            ret = INIPARSER_ENOTFOUND;
+        }
+        else
+        {
+            ret = iniparser_bind_value(b->type, str, (char *)cfg + b->offset);
+            if (ret == INIPARSER_ESYNTAX)
+                iniparser_error_callback("iniparser: %s: invalid value [%s]\n", b->key, str);
+            else if (ret == INIPARSER_ERANGE)
+                iniparser_error_callback("iniparser: %s: value out of range [%s]\n", b->key, str);
+        }
+        if (first == INIPARSER_OK)
+            first = ret;
+    }
+    return first;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get the string associated to a key, convert to a boolean
+  @param    d Dictionary to search
+  @param    key Key string to look for
+  @param    notfound Value to return in case of error
+  @return   integer
+
+  This function queries a dictionary for a key. A key as read from an
+  ini file is given as "section:key". If the key cannot be found,
+  the notfound value is returned.
 
   A true boolean is found if one of the following is matched:
 
@@ -663,25 +1400,182 @@ double iniparser_getdouble(const struct dictionary *d, const char *key, double n
 /*--------------------------------------------------------------------------*/
 int iniparser_getboolean(const struct dictionary *d, const char *key, int notfound)
 {
-    int ret;
-    const char *c;
+    struct bucket *b;
+    const char *str = iniparser_getvalue(d, key, &b);
 
-    c = iniparser_getstring(d, key, INI_INVALID_KEY);
-    if (c == NULL || c == INI_INVALID_KEY)
-        return notfound;
-    if (c[0] == 'y' || c[0] == 'Y' || c[0] == '1' || c[0] == 't' || c[0] == 'T')
-    {
-        ret = 1;
-    }
-    else if (c[0] == 'n' || c[0] == 'N' || c[0] == '0' || c[0] == 'f' || c[0] == 'F')
-    {
-        ret = 0;
-    }
-    else
+    return iniparser_conv_boolean(str, b, notfound);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Key handle: a lowercased key, its hash and a slot hint
+
+  The hint names the entry the key was last found in, together with the
+  dictionary and its generation at that time. Generations are never
+  reused, so a matching (dictionary, generation) pair guarantees the entry
+  is still in place. The hint is guarded by a sequence counter so that
+  readers on several threads can share a handle: it is odd while being
+  rewritten, and readers only trust a hint read between two equal even
+  values.
+ */
+/*--------------------------------------------------------------------------*/
+struct iniparser_key
+{
+    unsigned hash;
+    unsigned seq;
+    const struct dictionary *hint_d;
+    unsigned long hint_gen;
+    struct bucket *hint_b;
+    char key[];
+};
+
+iniparser_key_t iniparser_key(const char *key)
+{
+    struct iniparser_key *h;
+    size_t len;
+
+    if (key == NULL)
+        return NULL;
+    len = strlen(key);
+    if (len > ASCIILINESZ)
+        len = ASCIILINESZ; /* same truncation as the string accessors */
+    h = (struct iniparser_key *)malloc(sizeof(*h) + len + 1);
+    if (h == NULL)
+        return NULL;
+    strlwc(key, h->key, (unsigned)len + 1);
+    h->hash = dictionary_hash(h->key);
+    h->seq = 0;
+    h->hint_d = NULL;
+    h->hint_gen = 0;
+    h->hint_b = NULL;
+    return h;
+}
+
+void iniparser_key_free(iniparser_key_t key)
+{
+    free(key);
+}
+
+static struct bucket *iniparser_key_hint(struct iniparser_key *h, const struct dictionary *d)
+{
+    const struct dictionary *hd;
+    unsigned long gen;
+    struct bucket *b;
+    unsigned seq;
+
+    seq = __atomic_load_n(&h->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1)
+        return NULL;
+    hd = __atomic_load_n(&h->hint_d, __ATOMIC_RELAXED);
+    gen = __atomic_load_n(&h->hint_gen, __ATOMIC_RELAXED);
+    b = __atomic_load_n(&h->hint_b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&h->seq, __ATOMIC_RELAXED) != seq)
+        return NULL;
+    if (hd != d || gen != d->generation)
+        return NULL;
+    return b;
+}
+
+static void iniparser_key_remember(struct iniparser_key *h, const struct dictionary *d,
+                                   struct bucket *b)
+{
+    unsigned seq = __atomic_load_n(&h->seq, __ATOMIC_RELAXED);
+
+    /* Another thread is updating the hint: leave it to them */
+    if ((seq & 1) ||
+        !__atomic_compare_exchange_n(&h->seq, &seq, seq + 1, 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return;
+    __atomic_store_n(&h->hint_d, d, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->hint_gen, d->generation, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->hint_b, b, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Look up a key handle for the handle accessors
+  @param    d       Dictionary to search
+  @param    h       Key handle
+  @param    b       Output: the entry holding the value, if there is one
+  @return   The value, or INI_INVALID_KEY if the key cannot be found
+
+  Same contract as iniparser_getvalue().
+ */
+/*--------------------------------------------------------------------------*/
+static const char *iniparser_getvalue_h(const struct dictionary *d, iniparser_key_t h,
+                                        struct bucket **b)
+{
+    *b = NULL;
+    if (d == NULL || h == NULL)
+        return INI_INVALID_KEY;
+
+    DICT_STAT(ini_lookups);
+    if (d->image || d->layers)
+        return dictionary_get_hashed(d, h->key, h->hash, INI_INVALID_KEY);
+    *b = iniparser_key_hint(h, d);
+    if (*b == NULL)
     {
-        ret = notfound;
+        *b = dictionary_find_hashed(d, h->key, h->hash);
+        if (*b == NULL)
+            return INI_INVALID_KEY;
+        iniparser_key_remember(h, d, *b);
     }
-    return ret;
+    return (*b)->value;
+}
+
+const char *iniparser_getstring_h(const struct dictionary *d, iniparser_key_t key, const char *def)
+{
+    struct bucket *b;
+    const char *str = iniparser_getvalue_h(d, key, &b);
+
+    return str == INI_INVALID_KEY ? def : str;
+}
+
+int iniparser_getint_h(const struct dictionary *d, iniparser_key_t key, int notfound)
+{
+    return ini_long_to_int(iniparser_getlongint_h(d, key, notfound));
+}
+
+long int iniparser_getlongint_h(const struct dictionary *d, iniparser_key_t key, long int notfound)
+{
+    struct bucket *b;
+    const char *str = iniparser_getvalue_h(d, key, &b);
+
+    return iniparser_conv_longint(str, b, notfound);
+}
+
+int64_t iniparser_getint64_h(const struct dictionary *d, iniparser_key_t key, int64_t notfound)
+{
+    struct bucket *b;
+    const char *str = iniparser_getvalue_h(d, key, &b);
+
+    return iniparser_conv_int64(str, b, notfound);
+}
+
+uint64_t iniparser_getuint64_h(const struct dictionary *d, iniparser_key_t key, uint64_t notfound)
+{
+    struct bucket *b;
+    const char *str = iniparser_getvalue_h(d, key, &b);
+
+    return iniparser_conv_uint64(str, b, notfound);
+}
+
+double iniparser_getdouble_h(const struct dictionary *d, iniparser_key_t key, double notfound)
+{
+    struct bucket *b;
+    const char *str = iniparser_getvalue_h(d, key, &b);
+
+    return iniparser_conv_double(str, b, notfound);
+}
+
+int iniparser_getboolean_h(const struct dictionary *d, iniparser_key_t key, int notfound)
+{
+    struct bucket *b;
+    const char *str = iniparser_getvalue_h(d, key, &b);
+
+    return iniparser_conv_boolean(str, b, notfound);
 }
 
 /*-------------------------------------------------------------------------*/
@@ -895,21 +1789,316 @@ static line_status iniparser_line(
     return sta;
 }
 
+/*
+ * @include support. An included file is parsed on its own into a fragment:
+ * a dictionary that is never modified afterwards, shared through a reference
+ * count by the cache and by every dictionary including it, which borrow its
+ * strings.
+ */
+#define INI_INCLUDE_DEPTH 16
+
+struct ini_fragment
+{
+    int refs;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    struct dictionary *dict;
+    struct ini_fragment *next;  /* cache chain */
+    struct ini_fragment **deps; /* fragments it includes, kept alive by dict */
+    size_t ndeps;
+    char path[];
+};
+
+/* The files being parsed, innermost first, for cycle detection */
+struct ini_include_frame
+{
+    const struct ini_include_frame *parent;
+    dev_t dev;
+    ino_t ino;
+    int depth;
+};
+
+static pthread_mutex_t ini_fragment_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ini_fragment *ini_fragments;
+
+static struct dictionary *iniparser_parse_file(FILE *in, const char *ininame, const int *cancel,
+                                               const struct ini_include_frame *frame,
+                                               struct ini_fragment *owner);
+
+static void ini_fragment_unref(void *p)
+{
+    struct ini_fragment *f = p;
+
+    if (__atomic_sub_fetch(&f->refs, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+    dictionary_del(f->dict);
+    free(f->deps);
+    free(f);
+}
+
+static int ini_fragment_same(const struct ini_fragment *f, const struct stat *st)
+{
+    return f->dev == st->st_dev && f->ino == st->st_ino && f->size == st->st_size &&
+           f->mtime.tv_sec == st->st_mtim.tv_sec && f->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+/* Whether the files included by f are still the ones it was built from */
+static int ini_fragment_fresh(const struct ini_fragment *f)
+{
+    struct stat st;
+    size_t i;
+
+    for (i = 0; i < f->ndeps; i++)
+    {
+        if (stat(f->deps[i]->path, &st) != 0 || !ini_fragment_same(f->deps[i], &st) ||
+            !ini_fragment_fresh(f->deps[i]))
+            return 0;
+    }
+    return 1;
+}
+
+/* With the lock held: a new reference on the cached fragment of st, if up to date */
+static struct ini_fragment *ini_fragment_lookup(const struct stat *st)
+{
+    struct ini_fragment **link;
+    struct ini_fragment *f;
+
+    for (link = &ini_fragments; (f = *link) != NULL; link = &f->next)
+    {
+        if (f->dev != st->st_dev || f->ino != st->st_ino)
+            continue;
+        if (ini_fragment_same(f, st) && ini_fragment_fresh(f))
+        {
+            __atomic_add_fetch(&f->refs, 1, __ATOMIC_RELAXED);
+            return f;
+        }
+        /* The file changed: users of the old fragment keep their reference */
+        *link = f->next;
+        ini_fragment_unref(f);
+        break;
+    }
+    return NULL;
+}
+
+/* A reference on the fragment of path, parsed unless the cache has it */
+static struct ini_fragment *ini_fragment_get(const char *path,
+                                             const struct ini_include_frame *parent,
+                                             const int *cancel)
+{
+    const struct ini_include_frame *fr;
+    struct ini_include_frame frame;
+    struct ini_fragment *f;
+    struct ini_fragment *cached;
+    struct stat st;
+    size_t len;
+    FILE *in;
+
+    if (parent->depth >= INI_INCLUDE_DEPTH)
+    {
+        iniparser_error_callback("iniparser: includes nested too deep at %s\n", path);
+        return NULL;
+    }
+    in = fopen(path, "r");
+    if (in == NULL || fstat(fileno(in), &st) != 0)
+    {
+        iniparser_error_callback("iniparser: cannot open %s\n", path);
+        if (in)
+            fclose(in);
+        return NULL;
+    }
+    for (fr = parent; fr; fr = fr->parent)
+    {
+        if (fr->dev == st.st_dev && fr->ino == st.st_ino)
+        {
+            iniparser_error_callback("iniparser: include cycle on %s\n", path);
+            fclose(in);
+            return NULL;
+        }
+    }
+
+    pthread_mutex_lock(&ini_fragment_lock);
+    f = ini_fragment_lookup(&st);
+    pthread_mutex_unlock(&ini_fragment_lock);
+    if (f)
+    {
+        fclose(in);
+        return f;
+    }
+
+    len = strlen(path);
+    f = calloc(1, sizeof(*f) + len + 1);
+    if (f == NULL)
+    {
+        iniparser_error_callback("iniparser: memory allocation failure\n");
+        fclose(in);
+        return NULL;
+    }
+    f->refs = 1;
+    f->dev = st.st_dev;
+    f->ino = st.st_ino;
+    f->size = st.st_size;
+    f->mtime = st.st_mtim;
+    memcpy(f->path, path, len + 1);
+    frame.parent = parent;
+    frame.dev = st.st_dev;
+    frame.ino = st.st_ino;
+    frame.depth = parent->depth + 1;
+    f->dict = iniparser_parse_file(in, path, cancel, &frame, f);
+    fclose(in);
+    if (f->dict == NULL)
+    {
+        free(f->deps);
+        free(f);
+        return NULL;
+    }
+
+    /* Another thread may have parsed the same file meanwhile */
+    pthread_mutex_lock(&ini_fragment_lock);
+    cached = ini_fragment_lookup(&st);
+    if (cached == NULL)
+    {
+        f->refs++;
+        f->next = ini_fragments;
+        ini_fragments = f;
+    }
+    pthread_mutex_unlock(&ini_fragment_lock);
+    if (cached)
+    {
+        ini_fragment_unref(f);
+        return cached;
+    }
+    return f;
+}
+
+/* Adds the entries of f to dict, which takes over the reference on f */
+static int ini_fragment_merge(struct dictionary *dict, struct ini_fragment *f,
+                              struct ini_fragment *owner)
+{
+    struct dictionary_iter it;
+    const char *key;
+    const char *val;
+
+    if (dictionary_hold(dict, ini_fragment_unref, f) != 0)
+    {
+        ini_fragment_unref(f);
+        return -1;
+    }
+    if (owner)
+    {
+        struct ini_fragment **deps = realloc(owner->deps, (owner->ndeps + 1) * sizeof(*deps));
+        if (deps == NULL)
+            return -1;
+        deps[owner->ndeps++] = f;
+        owner->deps = deps;
+    }
+    dictionary_iter_init(&it, f->dict);
+    while (dictionary_iter_next(&it, &key, &val))
+    {
+        if (dictionary_set_borrowed(dict, key, val) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int iniparser_is_include(const char *line)
+{
+    line += strspn(line, " \t");
+    return strncmp(line, "@include", 8) == 0 &&
+           (line[8] == '\0' || isspace((unsigned char)line[8]));
+}
+
 /*-------------------------------------------------------------------------*/
 /**
-  @brief    Parse an ini file and return an allocated dictionary object
-  @param    in File to read.
-  @param    ininame Name of the ini file to read (only used for nicer error messages)
-  @return   Pointer to newly allocated dictionary
+  @brief    Merge the file named by an @include line into dict
+  @return   0 on success, -1 after reporting an error
 
-  This is the parser for ini files. This function is called, providing
-  the file to be read. It returns a dictionary object that should not
-  be accessed directly, but through accessor functions instead.
+  The path may be quoted. Unless absolute, it is relative to the directory
+  of ininame.
+ */
+/*--------------------------------------------------------------------------*/
+static int iniparser_include(struct dictionary *dict, const char *line,
+                             const char *ininame, int lineno, const int *cancel,
+                             const struct ini_include_frame *frame,
+                             struct ini_fragment *owner)
+{
+    const char *slash = strrchr(ininame, '/');
+    const char *name;
+    struct ini_fragment *f;
+    size_t dirlen = 0;
+    size_t len;
+    char *path;
 
-  The returned dictionary must be freed using iniparser_freedict().
+    name = line + strspn(line, " \t") + 8;
+    name += strspn(name, " \t");
+    len = strlen(name);
+    if (len >= 2 && (name[0] == '"' || name[0] == '\'') && name[len - 1] == name[0])
+    {
+        name++;
+        len -= 2;
+    }
+    if (len == 0)
+    {
+        iniparser_error_callback(
+            "iniparser: syntax error in %s (%d):\n-> %s\n",
+            ininame,
+            lineno,
+            line);
+        return -1;
+    }
+
+    if (name[0] != '/' && slash)
+        dirlen = (size_t)(slash - ininame) + 1;
+    path = malloc(dirlen + len + 1);
+    if (path == NULL)
+    {
+        iniparser_error_callback("iniparser: memory allocation failure\n");
+        return -1;
+    }
+    memcpy(path, ininame, dirlen);
+    memcpy(path + dirlen, name, len);
+    path[dirlen + len] = '\0';
+    f = ini_fragment_get(path, frame, cancel);
+    free(path);
+    if (f == NULL)
+        return -1;
+    if (ini_fragment_merge(dict, f, owner) != 0)
+    {
+        iniparser_error_callback("iniparser: memory allocation failure\n");
+        return -1;
+    }
+    return 0;
+}
+
+void iniparser_include_cache_clear(void)
+{
+    struct ini_fragment *f;
+
+    pthread_mutex_lock(&ini_fragment_lock);
+    f = ini_fragments;
+    ini_fragments = NULL;
+    pthread_mutex_unlock(&ini_fragment_lock);
+    while (f)
+    {
+        struct ini_fragment *next = f->next;
+        ini_fragment_unref(f);
+        f = next;
+    }
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Parse an ini stream into a new dictionary (iniparser_load_file body)
+
+  Gives up and returns NULL as soon as *cancel is non-zero, if cancel is
+  not NULL. frame is NULL for a top-level file; owner is the fragment
+  being built for an included one.
  */
 /*--------------------------------------------------------------------------*/
-struct dictionary *iniparser_load_file(FILE *in, const char *ininame)
+static struct dictionary *iniparser_parse_file(FILE *in, const char *ininame, const int *cancel,
+                                               const struct ini_include_frame *frame,
+                                               struct ini_fragment *owner)
 {
     char line[ASCIILINESZ + 1];
     char section[ASCIILINESZ + 1];
@@ -923,8 +2112,20 @@ struct dictionary *iniparser_load_file(FILE *in, const char *ininame)
     int errs = 0;
     int mem_err = 0;
 
+    struct ini_include_frame top = { NULL, 0, 0, 0 };
+    struct stat st;
     struct dictionary *dict;
 
+    if (frame == NULL)
+    {
+        if (fstat(fileno(in), &st) == 0)
+        {
+            top.dev = st.st_dev;
+            top.ino = st.st_ino;
+        }
+        frame = &top;
+    }
+
     dict = dictionary_new(0);
     if (!dict)
     {
@@ -939,6 +2140,11 @@ struct dictionary *iniparser_load_file(FILE *in, const char *ininame)
 
     while (fgets(line + last, ASCIILINESZ - last, in) != NULL)
     {
+        if (cancel && __atomic_load_n(cancel, __ATOMIC_RELAXED))
+        {
+            dictionary_del(dict);
+            return NULL;
+        }
         lineno++;
         len = (int)strlen(line) - 1;
         if (len <= 0)
@@ -975,6 +2181,13 @@ struct dictionary *iniparser_load_file(FILE *in, const char *ininame)
         {
             last = 0;
         }
+        if (iniparser_is_include(line))
+        {
+            if (iniparser_include(dict, line, ininame, lineno, cancel, frame, owner) != 0)
+                errs++;
+            memset(line, 0, ASCIILINESZ);
+            continue;
+        }
         switch (iniparser_line(line, section, key, val))
         {
         case LINE_EMPTY:
@@ -1018,6 +2231,42 @@ struct dictionary *iniparser_load_file(FILE *in, const char *ininame)
     return dict;
 }
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Parse an ini file and return an allocated dictionary object
+  @param    in File to read.
+  @param    ininame Name of the ini file to read (used for error messages
+                    and to resolve relative @include paths)
+  @return   Pointer to newly allocated dictionary
+
+  This is the parser for ini files. This function is called, providing
+  the file to be read. It returns a dictionary object that should not
+  be accessed directly, but through accessor functions instead.
+
+  The returned dictionary must be freed using iniparser_freedict().
+ */
+/*--------------------------------------------------------------------------*/
+struct dictionary *iniparser_load_file(FILE *in, const char *ininame)
+{
+    struct dictionary *dict;
+
+    DICT_TRACE_BEGIN(__func__, ininame);
+    dict = iniparser_parse_file(in, ininame, NULL, NULL, NULL);
+    DICT_TRACE_END(__func__, ininame);
+    return dict;
+}
+
+struct dictionary *iniparser_load_file_cancellable(FILE *in, const char *ininame,
+                                                   const int *cancel)
+{
+    struct dictionary *dict;
+
+    DICT_TRACE_BEGIN("iniparser_load_file", ininame);
+    dict = iniparser_parse_file(in, ininame, cancel, NULL, NULL);
+    DICT_TRACE_END("iniparser_load_file", ininame);
+    return dict;
+}
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Parse an ini file and return an allocated dictionary object
@@ -1049,6 +2298,142 @@ struct dictionary *iniparser_load(const char *ininame)
     return dict;
 }
 
+/* Change list under construction; keys point into the dictionaries */
+struct ini_diff
+{
+    struct iniparser_change *list;
+    size_t count;
+    size_t cap;
+    size_t keybytes;
+};
+
+static int ini_diff_add(struct ini_diff *diff, const char *key, enum iniparser_change_type type)
+{
+    if (diff->count == diff->cap)
+    {
+        size_t cap = diff->cap ? diff->cap * 2 : 16;
+        struct iniparser_change *list = realloc(diff->list, cap * sizeof(*list));
+        if (list == NULL)
+            return -1;
+        diff->list = list;
+        diff->cap = cap;
+    }
+    diff->list[diff->count].key = key;
+    diff->list[diff->count].type = type;
+    diff->count++;
+    diff->keybytes += strlen(key) + 1;
+    return 0;
+}
+
+static int ini_change_cmp(const void *a, const void *b)
+{
+    return strcmp(((const struct iniparser_change *)a)->key,
+                  ((const struct iniparser_change *)b)->key);
+}
+
+static int ini_value_same(const char *a, const char *b)
+{
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+int iniparser_reload(struct dictionary *d, const char *path,
+                     struct iniparser_changes **changes)
+{
+    struct ini_diff diff = { NULL, 0, 0, 0 };
+    struct iniparser_changes *out;
+    struct dictionary_iter it;
+    struct dictionary *nd;
+    const char *key;
+    const char *val;
+    struct bucket *b;
+    char *keys;
+    size_t i;
+    int batched;
+    int ret = 0;
+
+    if (changes)
+        *changes = NULL;
+    if (d == NULL || path == NULL || d->image || d->layers)
+        return -1;
+    nd = iniparser_load(path);
+    if (nd == NULL)
+        return -1;
+
+    dictionary_iter_init(&it, nd);
+    while (ret == 0 && dictionary_iter_next(&it, &key, &val))
+    {
+        b = dictionary_find(d, key);
+        if (b == NULL)
+            ret = ini_diff_add(&diff, key, INIPARSER_CHANGE_ADDED);
+        else if (!ini_value_same(b->value, val))
+            ret = ini_diff_add(&diff, key, INIPARSER_CHANGE_UPDATED);
+    }
+    dictionary_iter_init(&it, d);
+    while (ret == 0 && dictionary_iter_next(&it, &key, &val))
+    {
+        if (dictionary_find(nd, key) == NULL)
+            ret = ini_diff_add(&diff, key, INIPARSER_CHANGE_REMOVED);
+    }
+
+    /* The keys are copied before applying anything: removals free them */
+    out = NULL;
+    if (ret == 0 && diff.count)
+        out = malloc(sizeof(*out) + diff.count * sizeof(out->change[0]) + diff.keybytes);
+    if (ret != 0 || (diff.count && out == NULL))
+    {
+        iniparser_error_callback("iniparser: memory allocation failure\n");
+        free(diff.list);
+        dictionary_del(nd);
+        return -1;
+    }
+    if (out)
+    {
+        qsort(diff.list, diff.count, sizeof(*diff.list), ini_change_cmp);
+        out->count = diff.count;
+        out->change = (struct iniparser_change *)(out + 1);
+        keys = (char *)(out->change + diff.count);
+        for (i = 0; i < diff.count; i++)
+        {
+            size_t len = strlen(diff.list[i].key) + 1;
+
+            memcpy(keys, diff.list[i].key, len);
+            out->change[i].key = keys;
+            out->change[i].type = diff.list[i].type;
+            keys += len;
+        }
+        free(diff.list);
+
+        /* Watchers of d get the whole reload as one batch */
+        batched = d->watch != NULL;
+        if (batched)
+            dictionary_batch_begin(d);
+        for (i = 0; ret == 0 && i < out->count; i++)
+        {
+            key = out->change[i].key;
+            if (out->change[i].type == INIPARSER_CHANGE_REMOVED)
+                dictionary_unset(d, key);
+            else
+                ret = dictionary_set(d, key, dictionary_get(nd, key, NULL));
+        }
+        if (batched)
+            dictionary_batch_end(d);
+    }
+    dictionary_del(nd);
+
+    if (ret != 0)
+        iniparser_error_callback("iniparser: memory allocation failure\n");
+    if (changes && ret == 0)
+        *changes = out;
+    else
+        free(out);
+    return ret == 0 ? 0 : -1;
+}
+
+void iniparser_changes_free(struct iniparser_changes *changes)
+{
+    free(changes);
+}
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Free all memory associated to an ini dictionary
@@ -166,6 +166,28 @@ const char ** iniparser_getseckeys(const struct dictionary * d, const char * s,
 /*--------------------------------------------------------------------------*/
 const char * iniparser_getstring(const struct dictionary * d, const char * key, const char * def);
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Enable or disable the lookup cache of the calling thread
+  @param    enable  Non-zero to enable the cache, 0 to disable it
+  @return   The previous setting
+
+  The cache remembers, per thread, the entries found by the last few
+  lookups of iniparser_getstring() and the typed accessors, keyed on the
+  address of the key string and of the dictionary. Reading the same key
+  again through the same pointer, typically a string literal, then skips
+  the case folding, hashing and bucket walk.
+
+  Entries are tagged with the generation of the dictionary, which changes
+  whenever a key is added or removed or the table is resized, so the cache
+  never returns an entry that has gone. Changing the value of an existing
+  key keeps cached entries valid and the new value is seen at once.
+
+  The cache is off by default. Enabling or disabling it empties it.
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_set_lookup_cache(int enable);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Get the string associated to a key, convert to an int
@@ -186,11 +208,14 @@ const char * iniparser_getstring(const struct dictionary * d, const char * key,
   - "042"     ->  34 (octal -> decimal)
   - "0x42"    ->  66 (hexa  -> decimal)
 
-  Warning: the conversion may overflow in various ways. Conversion is
-  totally outsourced to strtol(), see the associated man page for overflow
-  handling.
+  Conversion uses a built-in parser that follows the strtol() rules but
+  ignores the locale. Out of range values saturate to INT_MIN/INT_MAX;
+  use iniparser_getint_checked() to detect them.
 
-  Credits: Thanks to A. Becker for suggesting strtol()
+  The typed accessors (this one, iniparser_getlongint(), getint64(),
+  getuint64(), getdouble() and getboolean()) remember the converted value
+  in the dictionary entry, so repeated reads of a key skip the conversion.
+  The cache is dropped when the entry is set again.
  */
 /*--------------------------------------------------------------------------*/
 int iniparser_getint(const struct dictionary * d, const char * key, int notfound);
@@ -215,9 +240,9 @@ int iniparser_getint(const struct dictionary * d, const char * key, int notfound
   - "042"     ->  34 (octal -> decimal)
   - "0x42"    ->  66 (hexa  -> decimal)
 
-  Warning: the conversion may overflow in various ways. Conversion is
-  totally outsourced to strtol(), see the associated man page for overflow
-  handling.
+  Conversion uses a built-in parser that follows the strtol() rules but
+  ignores the locale. Out of range values saturate to LONG_MIN/LONG_MAX;
+  use iniparser_getlongint_checked() to detect them.
  */
 /*--------------------------------------------------------------------------*/
 long int iniparser_getlongint(const struct dictionary * d, const char * key, long int notfound);
@@ -242,9 +267,9 @@ long int iniparser_getlongint(const struct dictionary * d, const char * key, lon
   - "042"     ->  34 (octal -> decimal)
   - "0x42"    ->  66 (hexa  -> decimal)
 
-  Warning: the conversion may overflow in various ways. Conversion is
-  totally outsourced to strtoimax(), see the associated man page for overflow
-  handling.
+  Conversion uses a built-in parser that follows the strtoimax() rules but
+  ignores the locale. Out of range values saturate to INT64_MIN/INT64_MAX;
+  use iniparser_getint64_checked() to detect them.
 
   This function is usefull on 32bit architectures where `long int` is only
   32bit.
@@ -272,9 +297,10 @@ int64_t iniparser_getint64(const struct dictionary * d, const char * key, int64_
   - "042"     ->  34 (octal -> decimal)
   - "0x42"    ->  66 (hexa  -> decimal)
 
-  Warning: the conversion may overflow in various ways. Conversion is
-  totally outsourced to strtoumax(), see the associated man page for overflow
-  handling.
+  Conversion uses a built-in parser that follows the strtoumax() rules but
+  ignores the locale: out of range values saturate to UINT64_MAX and a
+  leading minus sign negates the result. Use iniparser_getuint64_checked()
+  to reject both.
 
   This function is usefull on 32bit architectures where `long int` is only
   32bit.
@@ -293,10 +319,94 @@ uint64_t iniparser_getuint64(const struct dictionary * d, const char * key, uint
   This function queries a dictionary for a key. A key as read from an
   ini file is given as "section:key". If the key cannot be found,
   the notfound value is returned.
+
+  The value is parsed as by strtod() in the "C" locale, whatever the
+  current locale is, and is correctly rounded.
  */
 /*--------------------------------------------------------------------------*/
 double iniparser_getdouble(const struct dictionary * d, const char * key, double notfound);
 
+/**
+  Status codes returned by the checked accessors below.
+ */
+enum iniparser_status {
+    INIPARSER_OK = 0,
+    INIPARSER_ENOTFOUND = -1,   /**< missing key, NULL value or NULL out */
+    INIPARSER_ESYNTAX = -2,     /**< not a number, or trailing garbage */
+    INIPARSER_ERANGE = -3       /**< does not fit the requested type */
+};
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get the value associated to a key as a number, reporting errors
+  @param    d   Dictionary to search
+  @param    key Key string to look for
+  @param    out Where to store the converted value
+  @return   INIPARSER_OK or one of the INIPARSER_E* codes
+
+  Checked counterparts of iniparser_getint(), getlongint(), getint64(),
+  getuint64() and getdouble(). The whole value, apart from surrounding
+  white space, must be a number of the requested type; otherwise an error
+  code is returned and *out is left untouched.
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_getint_checked(const struct dictionary * d, const char * key, int * out);
+int iniparser_getlongint_checked(const struct dictionary * d, const char * key, long int * out);
+int iniparser_getint64_checked(const struct dictionary * d, const char * key, int64_t * out);
+int iniparser_getuint64_checked(const struct dictionary * d, const char * key, uint64_t * out);
+int iniparser_getdouble_checked(const struct dictionary * d, const char * key, double * out);
+
+/**
+  Field types for iniparser_bind().
+ */
+enum iniparser_type {
+    INIPARSER_TYPE_INT,         /**< int */
+    INIPARSER_TYPE_LONG,        /**< long int */
+    INIPARSER_TYPE_INT64,       /**< int64_t */
+    INIPARSER_TYPE_UINT64,      /**< uint64_t */
+    INIPARSER_TYPE_DOUBLE,      /**< double */
+    INIPARSER_TYPE_BOOL,        /**< int, 0 or 1 */
+    INIPARSER_TYPE_STRING       /**< const char *, owned by the dictionary */
+};
+
+/**
+  One field of a configuration struct filled in by iniparser_bind().
+ */
+struct iniparser_binding {
+    const char * key;           /**< "section:key", in lowercase */
+    enum iniparser_type type;   /**< type of the field */
+    size_t offset;              /**< offsetof() the field in the struct */
+    const char * def;           /**< default as written in an ini file, NULL if required */
+};
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Fill a configuration struct from a dictionary
+  @param    d       Dictionary to read
+  @param    binding Table describing the fields of the struct
+  @param    n       Number of entries in the table
+  @param    cfg     Struct to fill
+  @return   INIPARSER_OK or the first of the INIPARSER_E* codes met
+
+  Looks up every key of the table once and stores its value, converted
+  with the same rules as the checked accessors, in the field at the given
+  offset of cfg. A missing key takes its default; if it has none, the
+  binding fails with INIPARSER_ENOTFOUND. A value that does not convert
+  fails with INIPARSER_ESYNTAX or INIPARSER_ERANGE and leaves its field
+  untouched. All keys are processed even after an error and every problem
+  is reported through the error callback.
+
+  Booleans follow iniparser_getboolean(), but a value that is not a
+  boolean is an error. String fields point into the dictionary, or to the
+  default, and remain valid as long as both do.
+
+  The tables are normally written by tools/inibind.c from a schema, so
+  that code reads plain struct fields instead of looking keys up.
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_bind(const struct dictionary * d, const struct iniparser_binding * binding,
+                   size_t n, void * cfg);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Get the string associated to a key, convert to a boolean
@@ -331,6 +441,59 @@ double iniparser_getdouble(const struct dictionary * d, const char * key, double
 /*--------------------------------------------------------------------------*/
 int iniparser_getboolean(const struct dictionary * d, const char * key, int notfound);
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Handle on a key that is looked up repeatedly
+ */
+/*--------------------------------------------------------------------------*/
+typedef struct iniparser_key *iniparser_key_t;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Prepare a key for repeated lookups
+  @param    key Key string, given as "section:key"
+  @return   Handle on the key, or NULL on error
+
+  The key is converted to lowercase and hashed once, so the
+  iniparser_get*_h() accessors below do not have to do it on every call.
+  A handle is not tied to a dictionary and can be used with any number of
+  them. It also remembers where the key was last found: as long as the
+  dictionary only has values of existing keys changed, later lookups go
+  straight to that entry without hashing or searching the table.
+
+  A handle can be shared between threads reading the same dictionaries.
+  Free it with iniparser_key_free().
+ */
+/*--------------------------------------------------------------------------*/
+iniparser_key_t iniparser_key(const char * key);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Free a key handle
+  @param    key Handle returned by iniparser_key(), may be NULL
+ */
+/*--------------------------------------------------------------------------*/
+void iniparser_key_free(iniparser_key_t key);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Accessors taking a key handle instead of a key string
+  @param    d Dictionary to search
+  @param    key Handle returned by iniparser_key()
+  @param    def/notfound Value to return in case of error
+
+  These behave exactly like the accessors of the same name without the
+  _h suffix.
+ */
+/*--------------------------------------------------------------------------*/
+const char * iniparser_getstring_h(const struct dictionary * d, iniparser_key_t key, const char * def);
+int iniparser_getint_h(const struct dictionary * d, iniparser_key_t key, int notfound);
+long int iniparser_getlongint_h(const struct dictionary * d, iniparser_key_t key, long int notfound);
+int64_t iniparser_getint64_h(const struct dictionary * d, iniparser_key_t key, int64_t notfound);
+uint64_t iniparser_getuint64_h(const struct dictionary * d, iniparser_key_t key, uint64_t notfound);
+double iniparser_getdouble_h(const struct dictionary * d, iniparser_key_t key, double notfound);
+int iniparser_getboolean_h(const struct dictionary * d, iniparser_key_t key, int notfound);
+
 
 /*-------------------------------------------------------------------------*/
 /**
@@ -404,7 +567,8 @@ struct dictionary * iniparser_load(const char * ininame);
 /**
   @brief    Parse an ini file and return an allocated dictionary object
   @param    in File to read.
-  @param    ininame Name of the ini file to read (only used for nicer error messages)
+  @param    ininame Name of the ini file to read (used for error messages
+                    and to resolve relative @include paths)
   @return   Pointer to newly allocated dictionary
 
   This is the parser for ini files. This function is called, providing
@@ -422,11 +586,96 @@ struct dictionary * iniparser_load(const char * ininame);
   sequence then those outlined above is invalid and may lead to unpredictable
   results.
 
+  A line of the form
+
+      @include path
+
+  (the path may be quoted) merges the entries of another ini file at that
+  point, as if it had been loaded on its own: it starts outside of any
+  section and its sections do not leak back into the including file. A
+  relative path is taken from the directory of ininame. An include that
+  cannot be read, or that leads back to a file being included, is an
+  error, like a syntax error.
+
+  Each included file is parsed once per process into an immutable
+  fragment, keyed on its device, inode, size and modification time, and
+  kept in a cache. Dictionaries that include it point at the strings of
+  the fragment instead of copying them, and keep it alive until they are
+  freed. A file that changes on disk is parsed again on its next include.
+
   The returned dictionary must be freed using iniparser_freedict().
  */
 /*--------------------------------------------------------------------------*/
 struct dictionary * iniparser_load_file(FILE * in, const char * ininame);
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Empty the cache of included files
+
+  Drops the cache references to the fragments parsed for @include lines.
+  Fragments still used by a loaded dictionary live until it is freed; the
+  next include of any file parses it again.
+ */
+/*--------------------------------------------------------------------------*/
+void iniparser_include_cache_clear(void);
+
+/**
+  Kinds of entries in the change list of iniparser_reload().
+ */
+enum iniparser_change_type {
+    INIPARSER_CHANGE_ADDED,     /**< key only in the new file */
+    INIPARSER_CHANGE_UPDATED,   /**< key in both, with another value */
+    INIPARSER_CHANGE_REMOVED    /**< key no longer in the file */
+};
+
+struct iniparser_change {
+    const char * key;           /**< "section:key", or a section name */
+    enum iniparser_change_type type;
+};
+
+/**
+  Change list returned by iniparser_reload(), sorted by key. It owns its
+  entries and key strings, allocated along with it; release it with
+  iniparser_changes_free().
+ */
+struct iniparser_changes {
+    size_t count;
+    struct iniparser_change * change;   /**< count entries */
+};
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Update a dictionary from a new version of its ini file
+  @param    d       Dictionary loaded earlier, e.g. by iniparser_load()
+  @param    path    Name of the ini file to read
+  @param    changes If not NULL, receives the list of changes, or NULL
+                    when nothing changed
+  @return   0 on success, -1 on error
+
+  Parses path and applies to d only what differs from it: keys that
+  appeared are added, keys with another value are updated and keys that
+  are gone are removed. The entries that did not change keep their
+  storage, so the pointers returned for them by iniparser_getstring()
+  stay valid across the reload. Callbacks registered with
+  dictionary_watch() receive all the changes in a single batch; a
+  dictionary nobody watches is updated without opening one.
+
+  If the file cannot be read or parsed, or d is a read-only dictionary, d
+  is left untouched and -1 is returned. Running out of memory while
+  applying the changes also returns -1, with d partly updated.
+ */
+/*--------------------------------------------------------------------------*/
+int iniparser_reload(struct dictionary * d, const char * path,
+                     struct iniparser_changes ** changes);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Release a change list
+  @param    changes Change list from iniparser_reload(), may be NULL
+ */
+/*--------------------------------------------------------------------------*/
+void iniparser_changes_free(struct iniparser_changes * changes);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Free all memory associated to an ini dictionary
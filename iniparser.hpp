@@ -0,0 +1,660 @@
+/*-------------------------------------------------------------------------*/
+/**
+   @file    iniparser.hpp
+   @brief   Header-only C++17 interface to iniparser.
+
+   Ini owns a dictionary and frees it on destruction. Lookups take
+   std::string_view and never allocate: the key is copied to a buffer on
+   the stack to be NUL-terminated for the C functions. Values are returned
+   as views into the dictionary, valid until the entry is modified or the
+   Ini is destroyed.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _INIPARSER_HPP_
+#define _INIPARSER_HPP_
+
+#include "iniparser.h"
+#include "iniparser_async.h"
+
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#endif
+
+namespace ini {
+
+namespace detail {
+
+/* Longest key or value the parser stores, ASCIILINESZ in iniparser.c */
+constexpr std::size_t key_max = 1024;
+
+/* NUL-terminated copy of a key; c_str() is NULL if the key is too long */
+class key_buf
+{
+public:
+    explicit key_buf(std::string_view s) noexcept : ok_(s.size() <= key_max)
+    {
+        if (ok_)
+        {
+            std::memcpy(buf_, s.data(), s.size());
+            buf_[s.size()] = '\0';
+        }
+    }
+
+    const char *c_str() const noexcept { return ok_ ? buf_ : nullptr; }
+
+private:
+    bool ok_;
+    char buf_[key_max + 1];
+};
+
+constexpr bool is_space(char c) noexcept
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+constexpr char to_lower(char c) noexcept
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+constexpr std::string_view trim(std::string_view s) noexcept
+{
+    while (!s.empty() && is_space(s.front()))
+        s.remove_prefix(1);
+    while (!s.empty() && is_space(s.back()))
+        s.remove_suffix(1);
+    return s;
+}
+
+/* Same notation as iniparser_getint(): decimal, 0 octal or 0x hexadecimal,
+ * with an optional sign. The whole value must be a number in range. */
+template <class T>
+std::optional<T> parse_integral(std::string_view s) noexcept
+{
+    bool neg = false;
+    int base = 10;
+
+    s = trim(s);
+    if (!s.empty() && (s.front() == '+' || s.front() == '-'))
+    {
+        neg = s.front() == '-';
+        s.remove_prefix(1);
+    }
+    if (s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+    {
+        base = 16;
+        s.remove_prefix(2);
+    }
+    else if (s.size() > 1 && s[0] == '0')
+    {
+        base = 8;
+        s.remove_prefix(1);
+    }
+
+    std::uint64_t mag;
+    const char *end = s.data() + s.size();
+    auto r = std::from_chars(s.data(), end, mag, base);
+    if (s.empty() || r.ec != std::errc() || r.ptr != end)
+        return std::nullopt;
+
+    using L = std::numeric_limits<T>;
+    if constexpr (std::is_signed_v<T>)
+    {
+        const std::uint64_t max = static_cast<std::uint64_t>(L::max());
+        if (neg)
+        {
+            if (mag > max + 1)
+                return std::nullopt;
+            return mag == max + 1 ? L::min() : static_cast<T>(-static_cast<T>(mag));
+        }
+        if (mag > max)
+            return std::nullopt;
+        return static_cast<T>(mag);
+    }
+    else
+    {
+        if ((neg && mag != 0) || mag > static_cast<std::uint64_t>(L::max()))
+            return std::nullopt;
+        return static_cast<T>(mag);
+    }
+}
+
+template <class T>
+std::optional<T> parse_floating(std::string_view s) noexcept
+{
+    T v;
+
+    s = trim(s);
+    if (!s.empty() && s.front() == '+')
+        s.remove_prefix(1);
+    const char *end = s.data() + s.size();
+    auto r = std::from_chars(s.data(), end, v);
+    if (s.empty() || r.ec != std::errc() || r.ptr != end)
+        return std::nullopt;
+    return v;
+}
+
+/* Same rules as iniparser_getboolean() */
+inline std::optional<bool> parse_bool(std::string_view s) noexcept
+{
+    if (s.empty())
+        return std::nullopt;
+    switch (s.front())
+    {
+    case 'y': case 'Y': case 't': case 'T': case '1':
+        return true;
+    case 'n': case 'N': case 'f': case 'F': case '0':
+        return false;
+    default:
+        return std::nullopt;
+    }
+}
+
+template <class T>
+std::optional<T> parse(std::string_view s) noexcept
+{
+    if constexpr (std::is_same_v<T, std::string_view>)
+        return s;
+    else if constexpr (std::is_same_v<T, bool>)
+        return parse_bool(s);
+    else if constexpr (std::is_integral_v<T>)
+        return parse_integral<T>(s);
+    else
+        return parse_floating<T>(s);
+}
+
+template <class T>
+constexpr bool is_value_type_v = std::is_same_v<T, std::string_view> || std::is_same_v<T, bool> ||
+                                 (std::is_integral_v<T> && sizeof(T) <= sizeof(std::uint64_t)) ||
+                                 std::is_floating_point_v<T>;
+
+} /* namespace detail */
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Hash a key as dictionary_hash() does, usable at compile time.
+  @param    s Key to hash, already in lowercase
+  @return   The same value as dictionary_hash() for the same bytes
+
+  Each byte goes through the conversion dictionary_hash() applies to it,
+  so keys with bytes above 0x7f hash alike whether char is signed or not.
+ */
+/*--------------------------------------------------------------------------*/
+constexpr unsigned hash(std::string_view s) noexcept
+{
+    unsigned h = 0;
+
+    for (char c : s)
+    {
+        h += static_cast<unsigned>(c);
+        h += (h << 10);
+        h ^= (h >> 6);
+    }
+    h += (h << 3);
+    h ^= (h >> 11);
+    h += (h << 15);
+    return h;
+}
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    A key folded to lowercase and hashed once, normally at compile
+            time through the _ikey literal:
+
+      using namespace ini::literals;
+      int n = ini.get<int>("server:threads"_ikey, 4);
+
+  Lookups with a hashed_key go straight to dictionary_get_hashed(): no
+  copy, no case folding and no hashing at run time.
+ */
+/*--------------------------------------------------------------------------*/
+class hashed_key
+{
+public:
+    /* Longest key that can be stored */
+    static constexpr std::size_t max_len = 127;
+
+    constexpr explicit hashed_key(std::string_view s) : str_(), len_(s.size()), hash_(0)
+    {
+        if (s.size() > max_len)
+            throw std::length_error("ini::hashed_key: key too long");
+        for (std::size_t i = 0; i < s.size(); i++)
+            str_[i] = detail::to_lower(s[i]);
+        str_[len_] = '\0';
+        hash_ = ini::hash(std::string_view(str_, len_));
+    }
+
+    constexpr const char *c_str() const noexcept { return str_; }
+    constexpr std::string_view view() const noexcept { return std::string_view(str_, len_); }
+    constexpr unsigned hash() const noexcept { return hash_; }
+
+private:
+    char str_[max_len + 1];
+    std::size_t len_;
+    unsigned hash_;
+};
+
+namespace literals {
+
+#if defined(__cpp_consteval)
+consteval
+#else
+constexpr
+#endif
+hashed_key operator""_ikey(const char *s, std::size_t n)
+{
+    return hashed_key(std::string_view(s, n));
+}
+
+} /* namespace literals */
+
+/* One dictionary entry; value is empty for section entries */
+struct entry
+{
+    std::string_view key;
+    std::optional<std::string_view> value;
+};
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Range over the entries of a dictionary accepted by a filter.
+
+  Entries come in the dictionary's iteration order. The dictionary must not
+  be modified while a range is being iterated.
+ */
+/*--------------------------------------------------------------------------*/
+template <class Filter>
+class entry_range
+{
+public:
+    class iterator
+    {
+    public:
+        using value_type = entry;
+        using difference_type = std::ptrdiff_t;
+        using reference = const entry &;
+        using pointer = const entry *;
+        using iterator_category = std::input_iterator_tag;
+
+        iterator() noexcept = default;
+
+        reference operator*() const noexcept { return cur_; }
+        pointer operator->() const noexcept { return &cur_; }
+
+        iterator &operator++() noexcept
+        {
+            advance();
+            return *this;
+        }
+
+        void operator++(int) noexcept { advance(); }
+
+        friend bool operator==(const iterator &a, const iterator &b) noexcept
+        {
+            return a.range_ == b.range_;
+        }
+
+        friend bool operator!=(const iterator &a, const iterator &b) noexcept
+        {
+            return !(a == b);
+        }
+
+    private:
+        friend class entry_range;
+
+        explicit iterator(const entry_range *r) noexcept : range_(r)
+        {
+            dictionary_iter_init(&it_, r->d_);
+            advance();
+        }
+
+        void advance() noexcept
+        {
+            const char *k;
+            const char *v;
+
+            while (range_ && dictionary_iter_next(&it_, &k, &v))
+            {
+                if (range_->filter_(k))
+                {
+                    cur_.key = k;
+                    cur_.value = v ? std::optional<std::string_view>(v) : std::nullopt;
+                    return;
+                }
+            }
+            range_ = nullptr;
+        }
+
+        const entry_range *range_ = nullptr;
+        struct dictionary_iter it_ = {};
+        entry cur_;
+    };
+
+    entry_range(const struct dictionary *d, Filter f) noexcept : d_(d), filter_(std::move(f)) {}
+
+    iterator begin() const noexcept { return d_ ? iterator(this) : iterator(); }
+    iterator end() const noexcept { return iterator(); }
+
+private:
+    const struct dictionary *d_;
+    Filter filter_;
+};
+
+namespace detail {
+
+struct section_filter
+{
+    bool operator()(const char *k) const noexcept { return std::strchr(k, ':') == nullptr; }
+};
+
+/* Keys are stored lowercase; the section name given by the user may not be */
+class key_filter
+{
+public:
+    explicit key_filter(std::string_view section) noexcept : len_(section.size())
+    {
+        if (len_ > key_max)
+            len_ = key_max + 1; /* matches nothing */
+        for (std::size_t i = 0; i < len_ && i < key_max; i++)
+            sec_[i] = to_lower(section[i]);
+    }
+
+    bool operator()(const char *k) const noexcept
+    {
+        return len_ <= key_max && std::strncmp(k, sec_, len_) == 0 && k[len_] == ':';
+    }
+
+private:
+    std::size_t len_;
+    char sec_[key_max];
+};
+
+} /* namespace detail */
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Move-only owner of an iniparser dictionary.
+ */
+/*--------------------------------------------------------------------------*/
+class Ini
+{
+public:
+    Ini() noexcept = default;
+
+    /* Takes ownership of d */
+    explicit Ini(struct dictionary *d) noexcept : d_(d) {}
+
+    /* Parses a file; the result is empty (false) if that fails */
+    static Ini load(const char *path) noexcept { return Ini(iniparser_load(path)); }
+
+    Ini(const Ini &) = delete;
+    Ini &operator=(const Ini &) = delete;
+
+    Ini(Ini &&o) noexcept : d_(o.release()) {}
+
+    Ini &operator=(Ini &&o) noexcept
+    {
+        if (this != &o)
+            reset(o.release());
+        return *this;
+    }
+
+    ~Ini() { reset(); }
+
+    explicit operator bool() const noexcept { return d_ != nullptr; }
+    struct dictionary *get() const noexcept { return d_; }
+
+    struct dictionary *release() noexcept { return std::exchange(d_, nullptr); }
+
+    void reset(struct dictionary *d = nullptr) noexcept
+    {
+        if (d_)
+            iniparser_freedict(d_);
+        d_ = d;
+    }
+
+    /* True if the key or section exists */
+    bool contains(std::string_view key) const noexcept
+    {
+        detail::key_buf k(key);
+        return d_ && k.c_str() && iniparser_find_entry(d_, k.c_str());
+    }
+
+    /* Raw value of a key; empty if the key is missing or is a section */
+    std::optional<std::string_view> value(std::string_view key) const noexcept
+    {
+        detail::key_buf k(key);
+        const char *v;
+
+        if (!d_ || !k.c_str())
+            return std::nullopt;
+        v = iniparser_getstring(d_, k.c_str(), nullptr);
+        if (!v)
+            return std::nullopt;
+        return std::string_view(v);
+    }
+
+    /*
+     * Typed value of a key: T is std::string_view, bool, an integral or a
+     * floating point type. Integers use the notation of iniparser_getint(),
+     * floating point values std::from_chars(); both ignore the locale.
+     * Empty if the key is missing, the value does not parse as a whole or
+     * does not fit in T.
+     */
+    template <class T>
+    std::optional<T> get(std::string_view key) const noexcept
+    {
+        static_assert(detail::is_value_type_v<T>, "unsupported value type");
+        auto v = value(key);
+        if (!v)
+            return std::nullopt;
+        return detail::parse<T>(*v);
+    }
+
+    template <class T>
+    T get(std::string_view key, T def) const noexcept
+    {
+        return get<T>(key).value_or(def);
+    }
+
+    /* Same lookups with a key hashed beforehand, see hashed_key */
+    bool contains(const hashed_key &key) const noexcept
+    {
+        return d_ && dictionary_get_hashed(d_, key.c_str(), key.hash(), missing()) != missing();
+    }
+
+    std::optional<std::string_view> value(const hashed_key &key) const noexcept
+    {
+        const char *v;
+
+        if (!d_)
+            return std::nullopt;
+        v = dictionary_get_hashed(d_, key.c_str(), key.hash(), nullptr);
+        if (!v)
+            return std::nullopt;
+        return std::string_view(v);
+    }
+
+    template <class T>
+    std::optional<T> get(const hashed_key &key) const noexcept
+    {
+        static_assert(detail::is_value_type_v<T>, "unsupported value type");
+        auto v = value(key);
+        if (!v)
+            return std::nullopt;
+        return detail::parse<T>(*v);
+    }
+
+    template <class T>
+    T get(const hashed_key &key, T def) const noexcept
+    {
+        return get<T>(key).value_or(def);
+    }
+
+    /* Sets or creates an entry; returns false on error. Like
+     * iniparser_set(), values are cut to the parser's line length. */
+    bool set(std::string_view key, std::string_view val) noexcept
+    {
+        detail::key_buf k(key);
+        detail::key_buf v(val.substr(0, detail::key_max));
+        return d_ && k.c_str() && iniparser_set(d_, k.c_str(), v.c_str()) == 0;
+    }
+
+    /* Creates a section, or an entry without a value */
+    bool set(std::string_view key) noexcept
+    {
+        detail::key_buf k(key);
+        return d_ && k.c_str() && iniparser_set(d_, k.c_str(), nullptr) == 0;
+    }
+
+    void unset(std::string_view key) noexcept
+    {
+        detail::key_buf k(key);
+        if (d_ && k.c_str())
+            iniparser_unset(d_, k.c_str());
+    }
+
+    /* Section entries: for (auto &e : ini.sections()) ... e.key */
+    entry_range<detail::section_filter> sections() const noexcept
+    {
+        return entry_range<detail::section_filter>(d_, detail::section_filter());
+    }
+
+    /* Entries of a section; keys are given as "section:key" */
+    entry_range<detail::key_filter> keys(std::string_view section) const noexcept
+    {
+        return entry_range<detail::key_filter>(d_, detail::key_filter(section));
+    }
+
+private:
+    /* Distinct from any value, to tell a missing key from a section */
+    static const char *missing() noexcept
+    {
+        static const char m = 0;
+        return &m;
+    }
+
+    struct dictionary *d_ = nullptr;
+};
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Load a file in the background, see iniparser_load_async().
+
+  The future holds the loaded Ini, or a std::system_error carrying the
+  errno value given to the completion callback.
+ */
+/*--------------------------------------------------------------------------*/
+inline std::future<Ini> load_async(const char *path, const iniparser_async_opts *opts = nullptr)
+{
+    auto promise = std::make_unique<std::promise<Ini>>();
+    std::future<Ini> f = promise->get_future();
+
+    auto cb = [](struct dictionary *d, int err, void *ctx) {
+        std::unique_ptr<std::promise<Ini>> p(static_cast<std::promise<Ini> *>(ctx));
+        if (d)
+            p->set_value(Ini(d));
+        else
+            p->set_exception(std::make_exception_ptr(
+                std::system_error(err, std::generic_category(), "iniparser_load_async")));
+    };
+    iniparser_load_op *op = iniparser_load_async(path, opts, cb, promise.get());
+    if (!op)
+        throw std::system_error(EAGAIN, std::generic_category(), "iniparser_load_async");
+    promise.release();
+    iniparser_load_op_free(op);
+    return f;
+}
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Awaitable background load for C++20 coroutines.
+
+      ini::Ini cfg = co_await ini::load_awaiter("app.ini");
+
+  The coroutine resumes on the thread that finished the load, which the
+  executor in opts decides. cancel() may be called from another thread
+  while the coroutine is suspended; co_await then throws ECANCELED.
+ */
+/*--------------------------------------------------------------------------*/
+class load_awaiter
+{
+public:
+    explicit load_awaiter(const char *path, const iniparser_async_opts *opts = nullptr) noexcept
+        : path_(path), opts_(opts)
+    {
+    }
+
+    load_awaiter(const load_awaiter &) = delete;
+    load_awaiter &operator=(const load_awaiter &) = delete;
+
+    ~load_awaiter() { iniparser_load_op_free(op_.load()); }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        handle_ = h;
+        iniparser_load_op *op = iniparser_load_async(path_, opts_, &load_awaiter::done, this);
+        if (!op)
+        {
+            err_ = EAGAIN;
+            return false;
+        }
+        op_.store(op);
+        /* Whoever comes second, this or done(), carries on the coroutine */
+        return state_.exchange(1) == 0;
+    }
+
+    Ini await_resume()
+    {
+        if (!result_)
+            throw std::system_error(err_, std::generic_category(), "iniparser_load_async");
+        return std::move(result_);
+    }
+
+    void cancel() noexcept { iniparser_load_cancel(op_.load()); }
+
+private:
+    static void done(struct dictionary *d, int err, void *ctx)
+    {
+        load_awaiter *self = static_cast<load_awaiter *>(ctx);
+        self->result_.reset(d);
+        self->err_ = err;
+        if (self->state_.exchange(1) == 1)
+            self->handle_.resume();
+    }
+
+    const char *path_;
+    const iniparser_async_opts *opts_;
+    std::coroutine_handle<> handle_;
+    std::atomic<iniparser_load_op *> op_{nullptr};
+    std::atomic<int> state_{0};
+    Ini result_;
+    int err_ = 0;
+};
+#endif
+
+} /* namespace ini */
+
+#endif
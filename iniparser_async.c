@@ -0,0 +1,336 @@
+/*-------------------------------------------------------------------------*/
+/**
+   @file    iniparser_async.c
+   @brief   Loading ini files off the calling thread.
+*/
+/*--------------------------------------------------------------------------*/
+
+#include <dirent.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "iniparser_async.h"
+#include "iniparser_private.h"
+
+/*
+ * A load is shared by the caller, who holds the handle until
+ * iniparser_load_op_free(), and the task, until it has called back.
+ */
+struct iniparser_load_op
+{
+    int refs;
+    int cancelled;
+    iniparser_load_cb cb;
+    void *ctx;
+    char path[];
+};
+
+static void load_op_unref(struct iniparser_load_op *op)
+{
+    if (__atomic_sub_fetch(&op->refs, 1, __ATOMIC_ACQ_REL) == 0)
+        free(op);
+}
+
+static void load_task(void *arg)
+{
+    struct iniparser_load_op *op = arg;
+    struct dictionary *d = NULL;
+    int err = 0;
+    FILE *in;
+
+    if (__atomic_load_n(&op->cancelled, __ATOMIC_RELAXED))
+    {
+        err = ECANCELED;
+    }
+    else if ((in = fopen(op->path, "r")) == NULL)
+    {
+        err = errno;
+    }
+    else
+    {
+        d = iniparser_load_file_cancellable(in, op->path, &op->cancelled);
+        fclose(in);
+        if (d == NULL)
+            err = EINVAL;
+    }
+
+    /* A cancellation that arrives before the callback always wins */
+    if (__atomic_load_n(&op->cancelled, __ATOMIC_RELAXED))
+    {
+        if (d)
+            iniparser_freedict(d);
+        d = NULL;
+        err = ECANCELED;
+    }
+    op->cb(d, err, op->ctx);
+    load_op_unref(op);
+}
+
+struct thread_start
+{
+    void (*task)(void *);
+    void *arg;
+};
+
+static void *thread_main(void *p)
+{
+    struct thread_start start = *(struct thread_start *)p;
+
+    free(p);
+    start.task(start.arg);
+    return NULL;
+}
+
+/* The default executor: one detached thread per task */
+static int thread_submit(void (*task)(void *), void *arg, void *ctx)
+{
+    struct thread_start *start;
+    pthread_t tid;
+
+    (void)ctx;
+    start = malloc(sizeof(*start));
+    if (start == NULL)
+        return -1;
+    start->task = task;
+    start->arg = arg;
+    if (pthread_create(&tid, NULL, thread_main, start) != 0)
+    {
+        free(start);
+        return -1;
+    }
+    pthread_detach(tid);
+    return 0;
+}
+
+static const struct iniparser_executor thread_executor = { thread_submit, NULL };
+
+struct iniparser_load_op *iniparser_load_async(const char *path,
+                                               const struct iniparser_async_opts *opts,
+                                               iniparser_load_cb cb, void *ctx)
+{
+    const struct iniparser_executor *ex = &thread_executor;
+    struct iniparser_load_op *op;
+    size_t len;
+
+    if (path == NULL || cb == NULL)
+        return NULL;
+    if (opts && opts->executor)
+        ex = opts->executor;
+
+    len = strlen(path);
+    op = malloc(sizeof(*op) + len + 1);
+    if (op == NULL)
+        return NULL;
+    op->refs = 2;
+    op->cancelled = 0;
+    op->cb = cb;
+    op->ctx = ctx;
+    memcpy(op->path, path, len + 1);
+
+    if (ex->submit(load_task, op, ex->ctx) != 0)
+    {
+        free(op);
+        return NULL;
+    }
+    return op;
+}
+
+void iniparser_load_cancel(struct iniparser_load_op *op)
+{
+    if (op)
+        __atomic_store_n(&op->cancelled, 1, __ATOMIC_RELAXED);
+}
+
+void iniparser_load_op_free(struct iniparser_load_op *op)
+{
+    if (op)
+        load_op_unref(op);
+}
+
+/*
+ * Directory loading: the fragments are parsed by a set of workers that
+ * claim file indexes in turn, the caller being one of them, then merged in
+ * file order by the caller.
+ */
+struct dir_load
+{
+    char **paths;
+    struct dictionary **frags;
+    size_t n;
+    size_t next;
+    unsigned running;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+static void dir_load_task(void *arg)
+{
+    struct dir_load *dl = arg;
+    size_t i;
+
+    while ((i = __atomic_fetch_add(&dl->next, 1, __ATOMIC_RELAXED)) < dl->n)
+        dl->frags[i] = iniparser_load(dl->paths[i]);
+
+    pthread_mutex_lock(&dl->lock);
+    if (--dl->running == 0)
+        pthread_cond_signal(&dl->cond);
+    pthread_mutex_unlock(&dl->lock);
+}
+
+static int dir_entry_cmp(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Sorted paths of the regular files in dir whose name matches pattern */
+static char **dir_list(const char *dir, const char *pattern, size_t *n)
+{
+    char **paths = NULL;
+    size_t cap = 0;
+    struct dirent *de;
+    struct stat st;
+    DIR *dp;
+
+    *n = 0;
+    dp = opendir(dir);
+    if (dp == NULL)
+    {
+        iniparser_error_callback("iniparser: cannot open %s\n", dir);
+        return NULL;
+    }
+    while ((de = readdir(dp)) != NULL)
+    {
+        size_t len;
+        char *p;
+
+        if (fnmatch(pattern, de->d_name, FNM_PERIOD) != 0)
+            continue;
+        len = strlen(dir) + strlen(de->d_name) + 2;
+        p = malloc(len);
+        if (p == NULL)
+            goto fail;
+        snprintf(p, len, "%s/%s", dir, de->d_name);
+        if (stat(p, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            free(p);
+            continue;
+        }
+        if (*n == cap)
+        {
+            char **grown = realloc(paths, (cap ? cap * 2 : 16) * sizeof(*paths));
+            if (grown == NULL)
+            {
+                free(p);
+                goto fail;
+            }
+            paths = grown;
+            cap = cap ? cap * 2 : 16;
+        }
+        paths[(*n)++] = p;
+    }
+    closedir(dp);
+    if (paths == NULL)
+        paths = malloc(sizeof(*paths));
+    else
+        qsort(paths, *n, sizeof(*paths), dir_entry_cmp);
+    return paths;
+
+fail:
+    iniparser_error_callback("iniparser: memory allocation failure\n");
+    closedir(dp);
+    while (*n)
+        free(paths[--*n]);
+    free(paths);
+    return NULL;
+}
+
+struct dictionary *iniparser_load_dir(const char *dir, const char *pattern,
+                                      const struct iniparser_async_opts *opts)
+{
+    struct dir_load dl;
+    struct dictionary *d = NULL;
+    const struct iniparser_executor *ex = &thread_executor;
+    unsigned threads = 0;
+    size_t total = 0;
+    size_t i;
+    unsigned w;
+
+    if (dir == NULL)
+        return NULL;
+    if (opts && opts->executor)
+        ex = opts->executor;
+    if (opts)
+        threads = opts->threads;
+    if (threads == 0)
+    {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = ncpu > 0 ? (unsigned)ncpu : 1;
+    }
+
+    memset(&dl, 0, sizeof(dl));
+    dl.paths = dir_list(dir, pattern ? pattern : "*.ini", &dl.n);
+    if (dl.paths == NULL)
+        return NULL;
+    dl.frags = calloc(dl.n ? dl.n : 1, sizeof(*dl.frags));
+    if (dl.frags == NULL)
+        goto out;
+    pthread_mutex_init(&dl.lock, NULL);
+    pthread_cond_init(&dl.cond, NULL);
+
+    if (threads > dl.n)
+        threads = dl.n ? (unsigned)dl.n : 1;
+    dl.running = threads;
+    for (w = 1; w < threads; w++)
+    {
+        if (ex->submit(dir_load_task, &dl, ex->ctx) != 0)
+        {
+            /* Fewer helpers: the remaining workers take their share */
+            pthread_mutex_lock(&dl.lock);
+            dl.running -= threads - w;
+            pthread_mutex_unlock(&dl.lock);
+            break;
+        }
+    }
+    dir_load_task(&dl);
+    pthread_mutex_lock(&dl.lock);
+    while (dl.running)
+        pthread_cond_wait(&dl.cond, &dl.lock);
+    pthread_mutex_unlock(&dl.lock);
+    pthread_cond_destroy(&dl.cond);
+    pthread_mutex_destroy(&dl.lock);
+
+    for (i = 0; i < dl.n; i++)
+    {
+        if (dl.frags[i] == NULL)
+            goto out;
+        total += dl.frags[i]->numOfElements;
+    }
+
+    /* Later files override earlier ones key by key. The table grows once
+       0.7 full: room for total entries takes total / 0.7 slots. */
+    d = dictionary_new((size_t)(total / 0.7) + 1);
+    for (i = 0; d && i < dl.n; i++)
+    {
+        if (dictionary_merge(d, dl.frags[i], DICTIONARY_MERGE_OVERWRITE) != 0)
+        {
+            dictionary_del(d);
+            d = NULL;
+        }
+    }
+
+out:
+    for (i = 0; i < dl.n; i++)
+    {
+        if (dl.frags && dl.frags[i])
+            iniparser_freedict(dl.frags[i]);
+        free(dl.paths[i]);
+    }
+    free(dl.frags);
+    free(dl.paths);
+    return d;
+}
@@ -0,0 +1,124 @@
+/*-------------------------------------------------------------------------*/
+/**
+   @file    iniparser_async.h
+   @brief   Loading ini files off the calling thread.
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _INIPARSER_ASYNC_H_
+#define _INIPARSER_ASYNC_H_
+
+#include "iniparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Where background work runs. submit() must arrange for task(arg) to be
+  called once, on any thread, and return 0; or return non-zero, without
+  calling it, if it cannot.
+ */
+struct iniparser_executor {
+    int (*submit)(void (*task)(void *), void * arg, void * ctx);
+    void * ctx;
+};
+
+/**
+  Options of iniparser_load_async() and iniparser_load_dir(). A NULL
+  options pointer, or a NULL executor, runs each task on a new detached
+  thread.
+ */
+struct iniparser_async_opts {
+    const struct iniparser_executor * executor;
+    unsigned int threads;   /**< parsers run at once by iniparser_load_dir(), 0 for one per CPU */
+};
+
+/**
+  Completion callback of iniparser_load_async(). On success d is the loaded
+  dictionary, owned by the callback from then on, and err is 0. Otherwise d
+  is NULL and err is an errno value: the error from opening the file,
+  EINVAL if it does not parse, ENOMEM or ECANCELED.
+ */
+typedef void (*iniparser_load_cb)(struct dictionary * d, int err, void * ctx);
+
+struct iniparser_load_op;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Load an ini file in the background
+  @param    path    Name of the ini file to read
+  @param    opts    Options, may be NULL
+  @param    cb      Called once with the result, on the loading thread
+  @param    ctx     Passed to cb
+  @return   Handle on the load, or NULL if it could not be started
+
+  Opens and parses the file like iniparser_load() does, without blocking
+  the caller. The callback is called exactly once if the load started; if
+  NULL is returned it is never called.
+
+  The handle must be released with iniparser_load_op_free(), at any time:
+  releasing it does not cancel the load.
+ */
+/*--------------------------------------------------------------------------*/
+struct iniparser_load_op * iniparser_load_async(const char * path,
+                                                const struct iniparser_async_opts * opts,
+                                                iniparser_load_cb cb, void * ctx);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Cancel a background load
+  @param    op  Handle returned by iniparser_load_async()
+
+  If the callback has not been called yet, the load stops as soon as
+  possible, between two lines of input at worst, and the callback gets
+  ECANCELED.
+ */
+/*--------------------------------------------------------------------------*/
+void iniparser_load_cancel(struct iniparser_load_op * op);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Release a load handle
+  @param    op  Handle returned by iniparser_load_async(), may be NULL
+ */
+/*--------------------------------------------------------------------------*/
+void iniparser_load_op_free(struct iniparser_load_op * op);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Load and merge all the ini files of a directory
+  @param    dir     Directory to read, e.g. "/etc/app/conf.d"
+  @param    pattern fnmatch() pattern selecting the files, NULL for "*.ini"
+  @param    opts    Options, may be NULL
+  @return   Pointer to newly allocated dictionary, or NULL on error
+
+  The regular files of dir whose name matches pattern are parsed in
+  parallel: the calling thread and up to opts->threads - 1 tasks submitted
+  to the executor each take the next file in turn. Names starting with a
+  dot only match a pattern that starts with one.
+
+  The results are then merged in the byte order of the file names, and a
+  key defined by several files gets the value of the last one, so
+  "10-base.ini" can be overridden by "20-local.ini". The merged dictionary
+  is sized from the total number of entries before being filled.
+
+  The function returns when everything is merged. If a file cannot be
+  read or parsed, the error is reported through the error callback and
+  NULL is returned. A directory with no matching file gives an empty
+  dictionary.
+
+  The calling thread blocks until every submitted task has finished, so
+  the executor must run them elsewhere: with an executor that queues tasks
+  on the caller's own event loop, this never returns. Use opts->threads = 1
+  to parse everything on the calling thread without submitting anything.
+ */
+/*--------------------------------------------------------------------------*/
+struct dictionary * iniparser_load_dir(const char * dir, const char * pattern,
+                                       const struct iniparser_async_opts * opts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
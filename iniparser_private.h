@@ -0,0 +1,17 @@
+#ifndef _INIPARSER_PRIVATE_H_
+#define _INIPARSER_PRIVATE_H_
+
+/* Internals shared between the iniparser translation units. Not part of
+ * the public interface. */
+
+#include <stdio.h>
+#include "dictionary.h"
+
+/* Receives the error messages, see iniparser_set_error_callback() */
+extern int (*iniparser_error_callback)(const char *, ...);
+
+/* iniparser_load_file() that stops, returning NULL, once *cancel is set */
+struct dictionary *iniparser_load_file_cancellable(FILE *in, const char *ininame,
+                                                   const int *cancel);
+
+#endif
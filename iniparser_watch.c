@@ -0,0 +1,253 @@
+/*-------------------------------------------------------------------------*/
+/**
+   @file    iniparser_watch.c
+   @brief   Reloading ini files when they change (Linux, inotify).
+*/
+/*--------------------------------------------------------------------------*/
+
+#include <errno.h>
+#include <fnmatch.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "iniparser_async.h"
+#include "iniparser_watch.h"
+#include "iniparser_private.h"
+
+#define WATCH_DEBOUNCE_MS 100
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+                      IN_DELETE_SELF | IN_MOVE_SELF)
+#define WATCH_GONE (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)
+
+struct iniparser_watch
+{
+    struct dict_root *root;
+    int ifd;
+    int stop[2];
+    pthread_t thread;
+    int is_dir;
+    unsigned int debounce_ms;
+    void (*notify)(int err, void *ctx);
+    void *ctx;
+    char *pattern;
+    char *path;
+    const char *name;   /* file watched in its directory, NULL for a directory */
+};
+
+struct dict_snapshot *iniparser_watch_acquire(struct iniparser_watch *w)
+{
+    return dict_snapshot_acquire(w->root);
+}
+
+static struct dictionary *watch_load(const struct iniparser_watch *w)
+{
+    if (w->is_dir)
+        return iniparser_load_dir(w->path, w->pattern, NULL);
+    return iniparser_load(w->path);
+}
+
+static void watch_reload(struct iniparser_watch *w)
+{
+    struct dictionary *d = watch_load(w);
+    int err = 0;
+
+    if (d == NULL)
+    {
+        err = EINVAL;
+    }
+    else if (dict_root_publish(w->root, d) != 0)
+    {
+        iniparser_freedict(d);
+        err = ENOMEM;
+    }
+    if (w->notify)
+        w->notify(err, w->ctx);
+}
+
+/* Reads the pending events; whether any of them concerns the watched files,
+ * or -1 once the watched directory itself is gone */
+static int watch_drain(struct iniparser_watch *w)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *ev;
+    int relevant = 0;
+    ssize_t len;
+    char *p;
+
+    while ((len = read(w->ifd, buf, sizeof(buf))) > 0)
+    {
+        for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len)
+        {
+            ev = (const struct inotify_event *)p;
+            if (ev->mask & WATCH_GONE)
+                relevant = -1;
+            else if (relevant < 0)
+                continue;
+            else if (ev->mask & IN_Q_OVERFLOW)
+                relevant = 1;
+            else if (ev->len == 0)
+                continue;
+            else if (w->name)
+                relevant |= strcmp(ev->name, w->name) == 0;
+            else
+                relevant |= fnmatch(w->pattern, ev->name, FNM_PERIOD) == 0;
+        }
+    }
+    return relevant;
+}
+
+static void *watch_main(void *arg)
+{
+    struct iniparser_watch *w = arg;
+    struct pollfd pfd[2];
+    int pending = 0;
+
+    pfd[0].fd = w->ifd;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = w->stop[0];
+    pfd[1].events = POLLIN;
+    for (;;)
+    {
+        /* Each new event restarts the quiet period */
+        int n = poll(pfd, 2, pending ? (int)w->debounce_ms : -1);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            iniparser_error_callback("iniparser: cannot watch %s\n", w->path);
+            break;
+        }
+        if (pfd[1].revents)
+            break;
+        if (n == 0)
+        {
+            pending = 0;
+            watch_reload(w);
+        }
+        else
+        {
+            int r = watch_drain(w);
+
+            if (r < 0)
+            {
+                iniparser_error_callback("iniparser: %s is gone, no longer watching\n",
+                                         w->path);
+                if (w->notify)
+                    w->notify(ENOENT, w->ctx);
+                break;
+            }
+            if (r)
+                pending = 1;
+        }
+    }
+    return NULL;
+}
+
+static void watch_free(struct iniparser_watch *w)
+{
+    if (w->ifd >= 0)
+        close(w->ifd);
+    if (w->stop[0] >= 0)
+    {
+        close(w->stop[0]);
+        close(w->stop[1]);
+    }
+    dict_root_del(w->root);
+    free(w->pattern);
+    free(w->path);
+    free(w);
+}
+
+/* The directory to watch; for a file, also points w->name at its name */
+static char *watch_dir(struct iniparser_watch *w)
+{
+    char *slash;
+
+    if (w->is_dir)
+        return strdup(w->path);
+    slash = strrchr(w->path, '/');
+    if (slash == NULL)
+    {
+        w->name = w->path;
+        return strdup(".");
+    }
+    w->name = slash + 1;
+    return strndup(w->path, slash == w->path ? 1 : (size_t)(slash - w->path));
+}
+
+struct iniparser_watch *iniparser_watch_start(const char *path,
+                                              const struct iniparser_watch_opts *opts)
+{
+    struct iniparser_watch *w;
+    struct dictionary *d;
+    struct stat st;
+    char *dir;
+    int ok;
+
+    if (path == NULL)
+        return NULL;
+    w = calloc(1, sizeof(*w));
+    if (w == NULL)
+        return NULL;
+    w->ifd = -1;
+    w->stop[0] = w->stop[1] = -1;
+    w->debounce_ms = opts && opts->debounce_ms ? opts->debounce_ms : WATCH_DEBOUNCE_MS;
+    if (w->debounce_ms > INT_MAX)
+        w->debounce_ms = INT_MAX;
+    w->notify = opts ? opts->notify : NULL;
+    w->ctx = opts ? opts->ctx : NULL;
+    w->pattern = strdup(opts && opts->pattern ? opts->pattern : "*.ini");
+    w->path = strdup(path);
+    if (w->pattern == NULL || w->path == NULL)
+        goto fail;
+
+    w->is_dir = stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+    d = watch_load(w);
+    if (d == NULL)
+        goto fail;
+    w->root = dict_root_new(d);
+    if (w->root == NULL)
+    {
+        iniparser_freedict(d);
+        goto fail;
+    }
+
+    w->ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->ifd < 0 || pipe(w->stop) != 0)
+        goto fail_watch;
+    dir = watch_dir(w);
+    if (dir == NULL)
+        goto fail;
+    ok = inotify_add_watch(w->ifd, dir, WATCH_EVENTS | IN_ONLYDIR) >= 0;
+    free(dir);
+    if (!ok)
+        goto fail_watch;
+
+    if (pthread_create(&w->thread, NULL, watch_main, w) != 0)
+        goto fail_watch;
+    return w;
+
+fail_watch:
+    iniparser_error_callback("iniparser: cannot watch %s\n", path);
+fail:
+    watch_free(w);
+    return NULL;
+}
+
+void iniparser_watch_stop(struct iniparser_watch *w)
+{
+    char c = 0;
+
+    if (w == NULL)
+        return;
+    while (write(w->stop[1], &c, 1) < 0 && errno == EINTR)
+        ;
+    pthread_join(w->thread, NULL);
+    watch_free(w);
+}
@@ -0,0 +1,87 @@
+/*-------------------------------------------------------------------------*/
+/**
+   @file    iniparser_watch.h
+   @brief   Reloading ini files when they change (Linux, inotify).
+*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef _INIPARSER_WATCH_H_
+#define _INIPARSER_WATCH_H_
+
+#include "iniparser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+  Options of iniparser_watch_start(). A NULL options pointer takes the
+  defaults of all fields.
+ */
+struct iniparser_watch_opts {
+    unsigned int debounce_ms;   /**< quiet time before reloading, 0 for 100 */
+    const char * pattern;       /**< files of a watched directory, NULL for "*.ini" */
+    /** Called on the watcher thread after each reload, with 0 if the new
+        version was published or an errno value if it was not, and with
+        ENOENT once the watched directory is gone. May be NULL. */
+    void (*notify)(int err, void * ctx);
+    void * ctx;                 /**< passed to notify */
+};
+
+struct iniparser_watch;
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Load an ini file or directory and keep it up to date
+  @param    path    Ini file, or directory loaded with iniparser_load_dir()
+  @param    opts    Options, may be NULL
+  @return   Watcher, or NULL if path cannot be loaded or watched
+
+  Loads path, then watches it with inotify from a background thread. Once
+  writes to it have stopped for opts->debounce_ms, it is parsed again on
+  that thread and the result is published with dict_root_publish(),
+  replacing the current version in a single atomic step. If it does not
+  parse, the current version is kept.
+
+  A file is watched through its directory, so that replacing it by a
+  rename is seen. Only completed writes (the file being closed) and
+  files being created, renamed or removed trigger a reload. Files pulled
+  in with @include are not watched.
+
+  If the watched directory is itself removed or renamed, notify is called
+  with ENOENT and the watcher stops reloading; the last version stays
+  available until iniparser_watch_stop().
+ */
+/*--------------------------------------------------------------------------*/
+struct iniparser_watch * iniparser_watch_start(const char * path,
+                                               const struct iniparser_watch_opts * opts);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Stop watching and release the watcher
+  @param    w   Watcher, may be NULL
+
+  Waits for a reload in progress. Snapshots acquired earlier remain valid
+  until they are released.
+ */
+/*--------------------------------------------------------------------------*/
+void iniparser_watch_stop(struct iniparser_watch * w);
+
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Get the current version of the configuration
+  @param    w   Watcher
+  @return   Snapshot to release with dict_snapshot_release()
+
+  Never blocks and never fails. All the values read from the snapshot
+  come from the same version of the file, whatever reloads happen
+  meanwhile; acquire a new snapshot to see them.
+ */
+/*--------------------------------------------------------------------------*/
+struct dict_snapshot * iniparser_watch_acquire(struct iniparser_watch * w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -197,13 +197,538 @@ void test_dictionary_dump(char* file_name)
     dictionary_del(dict);
 }
 
+void test_inline_storage(void)
+{
+    struct dictionary *dict = dictionary_new(0);
+    char long_key[64];
+    char long_val[64];
+
+    memset(long_key, 'k', sizeof(long_key) - 1);
+    long_key[sizeof(long_key) - 1] = '\0';
+    memset(long_val, 'v', sizeof(long_val) - 1);
+    long_val[sizeof(long_val) - 1] = '\0';
+
+    /* 短字串存在 bucket 內，長字串退回 heap */
+    assert(dictionary_set(dict, "db:port", "5432") == 0);
+    assert(dictionary_set(dict, long_key, long_val) == 0);
+    const char *port = dictionary_get(dict, "db:port", NULL);
+    assert(strcmp(port, "5432") == 0);
+    assert(strcmp(dictionary_get(dict, long_key, NULL), long_val) == 0);
+
+    /* 其他 key 的插入與擴張不影響已取得的指標 */
+    for (int i = 0; i < 500; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "k%d", i);
+        assert(dictionary_set(dict, key, "x") == 0);
+    }
+    assert(port == dictionary_get(dict, "db:port", NULL));
+    assert(strcmp(port, "5432") == 0);
+
+    /* 長短互換 */
+    assert(dictionary_set(dict, "db:port", long_val) == 0);
+    assert(strcmp(dictionary_get(dict, "db:port", NULL), long_val) == 0);
+    assert(dictionary_set(dict, long_key, "1") == 0);
+    assert(strcmp(dictionary_get(dict, long_key, NULL), "1") == 0);
+
+    dictionary_del(dict);
+}
+
+void test_inplace_update(void)
+{
+    struct dictionary *dict = dictionary_new(0);
+    const char *first, *second;
+
+    assert(dictionary_set(dict, "ctr", "counter-value-0000001") == 0);
+    first = dictionary_get(dict, "ctr", NULL);
+
+    /* 同長度覆寫：沿用原緩衝區 */
+    assert(dictionary_set(dict, "ctr", "counter-value-0000002") == 0);
+    second = dictionary_get(dict, "ctr", NULL);
+    assert(first == second);
+    assert(strcmp(second, "counter-value-0000002") == 0);
+
+    /* 較短的值、NULL 之後再寫回，緩衝區仍保留 */
+    assert(dictionary_set(dict, "ctr", "1") == 0);
+    assert(dictionary_get(dict, "ctr", NULL) == first);
+    assert(dictionary_set(dict, "ctr", NULL) == 0);
+    assert(dictionary_get(dict, "ctr", "def") == NULL);
+    assert(dictionary_set(dict, "ctr", "counter-value-0000003") == 0);
+    assert(dictionary_get(dict, "ctr", NULL) == first);
+
+#ifdef DICTIONARY_STATS
+    struct dictionary_stats st;
+    dictionary_stats_reset();
+    for (int i = 0; i < 100; i++) {
+        char val[32];
+        snprintf(val, sizeof(val), "counter-value-%07d", i);
+        assert(dictionary_set(dict, "ctr", val) == 0);
+    }
+    assert(dictionary_stats_get(&st) == 0);
+    assert(st.allocs == 0);
+#endif
+
+    /* 放不下時才成長 */
+    assert(dictionary_set(dict, "ctr", "a much longer counter value than before") == 0);
+    assert(strcmp(dictionary_get(dict, "ctr", NULL),
+                  "a much longer counter value than before") == 0);
+
+    dictionary_del(dict);
+}
+
+void test_value_interning(void)
+{
+    struct dictionary *dict = dictionary_new(0);
+
+    assert(dictionary_set(dict, "plain", "TRUE") == 0);
+    assert(dictionary_set_interning(dict, 1) == 0);
+
+    assert(dictionary_set(dict, "a:flag", "TRUE") == 0);
+    assert(dictionary_set(dict, "b:flag", "TRUE") == 0);
+    assert(dictionary_set(dict, "c:path", "/a/rather/long/shared/path") == 0);
+    assert(dictionary_set(dict, "d:path", "/a/rather/long/shared/path") == 0);
+
+    /* 相同的值共用同一份儲存，比較指標即可 */
+    assert(dictionary_get(dict, "a:flag", NULL) == dictionary_get(dict, "b:flag", NULL));
+    assert(dictionary_get(dict, "c:path", NULL) == dictionary_get(dict, "d:path", NULL));
+    /* 啟用前設定的值不在 pool 內 */
+    assert(dictionary_get(dict, "plain", NULL) != dictionary_get(dict, "a:flag", NULL));
+
+    /* 覆寫、刪除、設為 NULL 都要正確釋放參照 */
+    assert(dictionary_set(dict, "a:flag", "FALSE") == 0);
+    assert(strcmp(dictionary_get(dict, "b:flag", NULL), "TRUE") == 0);
+    dictionary_unset(dict, "b:flag");
+    assert(dictionary_set(dict, "c:path", NULL) == 0);
+    assert(strcmp(dictionary_get(dict, "d:path", NULL), "/a/rather/long/shared/path") == 0);
+
+    for (int i = 0; i < 200; i++) {
+        char key[16], val[16];
+        snprintf(key, sizeof(key), "k%d", i);
+        snprintf(val, sizeof(val), "%d", i % 7);
+        assert(dictionary_set(dict, key, val) == 0);
+    }
+    assert(dictionary_get(dict, "k0", NULL) == dictionary_get(dict, "k7", NULL));
+
+    /* 關閉後的新值回到私有緩衝區 */
+    assert(dictionary_set_interning(dict, 0) == 0);
+    assert(dictionary_set(dict, "k1", "0") == 0);
+    assert(dictionary_get(dict, "k1", NULL) != dictionary_get(dict, "k0", NULL));
+    assert(strcmp(dictionary_get(dict, "k1", NULL), "0") == 0);
+
+    dictionary_del(dict);
+}
+
+void test_dict_root(void)
+{
+    struct dictionary *d1 = dictionary_new(0);
+    assert(d1 && dictionary_set(d1, "mode", "old") == 0);
+    struct dict_root *root = dict_root_new(d1);
+    assert(root);
+    assert(dict_root_new(NULL) == NULL);
+
+    struct dict_snapshot *s1 = dict_snapshot_acquire(root);
+    assert(s1->dict == d1);
+    const char *mode = dictionary_get(s1->dict, "mode", NULL);
+
+    /* 發布新版本後，舊快照與其中的字串仍然有效 */
+    struct dictionary *d2 = dictionary_new(0);
+    assert(d2 && dictionary_set(d2, "mode", "new") == 0);
+    assert(dict_root_publish(root, d2) == 0);
+    struct dict_snapshot *s2 = dict_snapshot_acquire(root);
+    assert(s2->dict == d2);
+    assert(strcmp(mode, "old") == 0);
+    assert(dict_root_publish(root, NULL) == -1);
+
+    /* 最後一個快照釋放時才刪除字典 */
+    dict_snapshot_release(s1);
+    dict_root_del(root);
+    assert(strcmp(dictionary_get(s2->dict, "mode", ""), "new") == 0);
+    dict_snapshot_release(s2);
+    dict_snapshot_release(NULL);
+}
+
+struct watch_log {
+    int calls;
+    size_t nkeys;
+    char keys[8][16];
+};
+
+static void log_changes(struct dictionary *d, const char *const *keys, size_t n, void *ctx)
+{
+    struct watch_log *log = ctx;
+    (void)d;
+    log->calls++;
+    for (size_t i = 0; i < n; i++) {
+        if (log->nkeys < 8)
+            snprintf(log->keys[log->nkeys], sizeof(log->keys[0]), "%s", keys[i]);
+        log->nkeys++;
+    }
+}
+
+static void set_in_callback(struct dictionary *d, const char *const *keys, size_t n, void *ctx)
+{
+    (void)keys; (void)n; (void)ctx;
+    dictionary_set(d, "derived", "1");
+}
+
+void test_dictionary_watch(void)
+{
+    struct dictionary *dict = dictionary_new(0);
+    struct watch_log all = { 0 }, srv = { 0 };
+    int id_all = dictionary_watch(dict, "", log_changes, &all);
+    int id_srv = dictionary_watch(dict, "server:", log_changes, &srv);
+    assert(id_all > 0 && id_srv > 0 && id_all != id_srv);
+
+    /* 每次修改立即通知；值相同不算修改 */
+    assert(dictionary_set(dict, "server:port", "80") == 0);
+    assert(dictionary_set(dict, "server:port", "80") == 0);
+    assert(dictionary_set(dict, "log:level", "info") == 0);
+    assert(all.calls == 2 && srv.calls == 1);
+    assert(strcmp(srv.keys[0], "server:port") == 0);
+
+    /* 批次內的修改合併，每個鍵只出現一次且已排序 */
+    memset(&all, 0, sizeof(all));
+    memset(&srv, 0, sizeof(srv));
+    dictionary_batch_begin(dict);
+    assert(dictionary_set(dict, "server:port", "81") == 0);
+    assert(dictionary_set(dict, "server:port", "82") == 0);
+    dictionary_batch_begin(dict);
+    assert(dictionary_set(dict, "server:host", "a") == 0);
+    dictionary_batch_end(dict);
+    dictionary_unset(dict, "log:level");
+    assert(all.calls == 0);
+    dictionary_batch_end(dict);
+    assert(all.calls == 1 && all.nkeys == 3);
+    assert(strcmp(all.keys[0], "log:level") == 0);
+    assert(strcmp(all.keys[1], "server:host") == 0);
+    assert(strcmp(all.keys[2], "server:port") == 0);
+    assert(srv.calls == 1 && srv.nkeys == 2);
+
+    /* 取消訂閱後不再通知 */
+    assert(dictionary_unwatch(dict, id_srv) == 0);
+    assert(dictionary_unwatch(dict, id_srv) == -1);
+    assert(dictionary_set(dict, "server:port", "83") == 0);
+    assert(srv.calls == 1 && all.calls == 2);
+
+    /* 回呼中的修改在下一輪送出 */
+    int id_set = dictionary_watch(dict, "server:", set_in_callback, NULL);
+    assert(dictionary_set(dict, "server:port", "84") == 0);
+    assert(all.calls == 4 && strcmp(all.keys[5], "derived") == 0);
+    assert(dictionary_unwatch(dict, id_set) == 0);
+
+    /* 以 bucket 自己的鍵刪除也安全 */
+    struct dictionary_iter it;
+    const char *key, *val;
+    dictionary_iter_init(&it, dict);
+    assert(dictionary_iter_next(&it, &key, &val));
+    dictionary_unset(dict, key);
+    assert(all.calls == 5);
+
+    dictionary_del(dict);
+}
+
+void test_dictionary_bulk(void)
+{
+    enum { N = 1000 };
+    static char kbuf[N][40], vbuf[N][16];
+    const char *keys[N + 1], *vals[N + 1];
+    for (int i = 0; i < N; i++) {
+        /* 一部分的鍵超過 inline 長度 */
+        snprintf(kbuf[i], sizeof(kbuf[i]), i % 3 ? "k%d" : "section:long key number %d", i);
+        snprintf(vbuf[i], sizeof(vbuf[i]), "v%d", i);
+        keys[i] = kbuf[i];
+        vals[i] = vbuf[i];
+    }
+    keys[N] = "k1";
+    vals[N] = "last";
+
+    struct dictionary *d = dictionary_new(0);
+    assert(dictionary_set(d, "k2", "old") == 0);
+    struct watch_log log = { 0 };
+    assert(dictionary_watch(d, "k1", log_changes, &log) > 0);
+    assert(dictionary_set_many(d, keys, vals, N + 1) == 0);
+    assert(d->numOfElements == N);
+    assert(d->numOfElements <= d->size * 0.7);
+    assert(strcmp(dictionary_get(d, "k1", ""), "last") == 0);
+    assert(strcmp(dictionary_get(d, "k2", ""), "v2") == 0);
+    assert(strcmp(dictionary_get(d, "section:long key number 999", ""), "v999") == 0);
+    /* 所有修改在同一個批次中送出 */
+    assert(log.calls == 1);
+    assert(dictionary_set_many(d, keys, NULL, 1) == 0);
+    assert(dictionary_get(d, keys[0], "") == NULL);
+    dictionary_unset(d, keys[0]);
+    dictionary_unset(d, "k4");
+    assert(d->numOfElements == N - 2);
+    assert(dictionary_set_many(d, NULL, NULL, 0) == 0);
+    keys[1] = NULL;
+    assert(dictionary_set_many(d, keys, vals, 2) == -1);
+
+    /* 兩種合併策略 */
+    struct dictionary *src = dictionary_new(0);
+    assert(dictionary_set(src, "k5", "from src") == 0);
+    assert(dictionary_set(src, "new", "n") == 0);
+    struct dictionary *keep = dictionary_clone(d);
+    assert(keep);
+    assert(dictionary_merge(d, src, DICTIONARY_MERGE_OVERWRITE) == 0);
+    assert(dictionary_merge(keep, src, DICTIONARY_MERGE_KEEP) == 0);
+    assert(strcmp(dictionary_get(d, "k5", ""), "from src") == 0);
+    assert(strcmp(dictionary_get(keep, "k5", ""), "v5") == 0);
+    assert(strcmp(dictionary_get(keep, "new", ""), "n") == 0);
+    assert(d->numOfElements == N - 1 && keep->numOfElements == N - 1);
+    assert(dictionary_merge(d, d, DICTIONARY_MERGE_KEEP) == -1);
+
+    /* 合併到空字典：內容相同 */
+    struct dictionary *copy = dictionary_new(0);
+    assert(dictionary_merge(copy, d, DICTIONARY_MERGE_OVERWRITE) == 0);
+    assert(copy->numOfElements == d->numOfElements);
+    struct dictionary_iter it;
+    const char *k, *v;
+    dictionary_iter_init(&it, d);
+    while (dictionary_iter_next(&it, &k, &v))
+        assert(strcmp(dictionary_get(copy, k, ""), v) == 0);
+
+    dictionary_del(copy);
+
+    /* Bulk updates into a clone: keys of one slot, all shared */
+    static char ckey[4][16];
+    const char *ckeys[4], *cvals[4] = { "c0", "c1", "c2", "c3" };
+    struct dictionary *base = dictionary_new(0);
+    unsigned slot = dictionary_hash("c0") % base->size;
+    for (int i = 0, m = 0; m < 4; i++) {
+        snprintf(ckey[m], sizeof(ckey[m]), "c%d", i);
+        if (dictionary_hash(ckey[m]) % base->size == slot) {
+            ckeys[m] = ckey[m];
+            assert(dictionary_set(base, ckeys[m++], "base") == 0);
+        }
+    }
+    struct dictionary *clone = dictionary_clone(base);
+    assert(clone);
+    assert(dictionary_set_many(clone, ckeys, cvals, 4) == 0);
+    for (int i = 0; i < 4; i++) {
+        assert(strcmp(dictionary_get(clone, ckeys[i], ""), cvals[i]) == 0);
+        assert(strcmp(dictionary_get(base, ckeys[i], ""), "base") == 0);
+    }
+    struct dictionary *clone2 = dictionary_clone(base);
+    assert(dictionary_merge(clone2, clone, DICTIONARY_MERGE_OVERWRITE) == 0);
+    assert(strcmp(dictionary_get(clone2, ckeys[3], ""), "c3") == 0);
+    dictionary_del(base);
+    dictionary_del(clone);
+    dictionary_del(clone2);
+    dictionary_del(keep);
+    dictionary_del(src);
+    dictionary_del(d);
+}
+
+void test_dictionary_clone(void)
+{
+    char key[32], val[48];
+    struct dictionary *base = dictionary_new(0);
+    assert(base);
+    for (int i = 0; i < 80; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        snprintf(val, sizeof(val), "value number %d of the base", i);
+        assert(dictionary_set(base, key, val) == 0);
+    }
+
+    /* 複製後共用同一份資料 */
+    struct dictionary *c1 = dictionary_clone(base);
+    assert(c1 && c1->numOfElements == 80);
+    assert(dictionary_get(c1, "k5", NULL) == dictionary_get(base, "k5", NULL));
+
+    /* 寫入只影響寫入的一方 */
+    assert(dictionary_set(c1, "k5", "five") == 0);
+    assert(dictionary_set(c1, "extra", "x") == 0);
+    dictionary_unset(c1, "k6");
+    assert(strcmp(dictionary_get(c1, "k5", ""), "five") == 0);
+    assert(strcmp(dictionary_get(base, "k5", ""), "value number 5 of the base") == 0);
+    assert(dictionary_get(base, "k6", NULL) && !dictionary_get(c1, "k6", NULL));
+    assert(!dictionary_get(base, "extra", NULL));
+    assert(dictionary_get(c1, "k7", NULL) == dictionary_get(base, "k7", NULL));
+    assert(c1->numOfElements == 80 && base->numOfElements == 80);
+
+    assert(dictionary_set(base, "k7", "seven") == 0);
+    assert(strcmp(dictionary_get(c1, "k7", ""), "value number 7 of the base") == 0);
+
+    /* 再次複製：新的共用層建立在前一層之上 */
+    struct dictionary *c2 = dictionary_clone(base);
+    struct dictionary *c3 = dictionary_clone(c1);
+    assert(c2 && c3);
+    assert(strcmp(dictionary_get(c2, "k7", ""), "seven") == 0);
+    assert(strcmp(dictionary_get(c3, "k5", ""), "five") == 0);
+    dictionary_del(base);
+    assert(strcmp(dictionary_get(c2, "k0", ""), "value number 0 of the base") == 0);
+
+    /* 擴充 table 時全部轉為私有 */
+    for (int i = 0; i < 300; i++) {
+        snprintf(key, sizeof(key), "grow%d", i);
+        assert(dictionary_set(c2, key, "g") == 0);
+    }
+    assert(c2->numOfElements == 380 && !c2->shared);
+    assert(strcmp(dictionary_get(c2, "k79", ""), "value number 79 of the base") == 0);
+    assert(strcmp(dictionary_get(c3, "k79", ""), "value number 79 of the base") == 0);
+    int n = 0;
+    struct dictionary_iter it;
+    const char *k, *v;
+    dictionary_iter_init(&it, c3);
+    while (dictionary_iter_next(&it, &k, &v))
+        n++;
+    assert(n == 80);
+    dictionary_del(c1);
+    dictionary_del(c2);
+    dictionary_del(c3);
+
+    /* 使用 interning 的字典 */
+    struct dictionary *in = dictionary_new(0);
+    assert(dictionary_set_interning(in, 1) == 0);
+    assert(dictionary_set(in, "a", "shared value") == 0);
+    assert(dictionary_set(in, "b", "shared value") == 0);
+    struct dictionary *ic = dictionary_clone(in);
+    assert(ic);
+    assert(dictionary_set(ic, "a", "other value") == 0);
+    assert(dictionary_set(in, "c", "shared value") == 0);
+    assert(dictionary_set(in, "d", "shared value") == 0);
+    dictionary_unset(in, "b");
+    assert(strcmp(dictionary_get(ic, "b", ""), "shared value") == 0);
+    assert(dictionary_get(in, "c", NULL) == dictionary_get(in, "d", NULL));
+    dictionary_del(in);
+    assert(strcmp(dictionary_get(ic, "a", ""), "other value") == 0);
+    dictionary_del(ic);
+}
+
+void test_dictionary_overlay(void)
+{
+    struct dictionary *defaults = dictionary_new(0);
+    struct dictionary *site = dictionary_new(0);
+    assert(defaults && site);
+    assert(dictionary_set(defaults, "net", NULL) == 0);
+    assert(dictionary_set(defaults, "net:port", "80") == 0);
+    assert(dictionary_set(defaults, "net:host", "localhost") == 0);
+    assert(dictionary_set(defaults, "log", NULL) == 0);
+    assert(dictionary_set(defaults, "log:level", "warn") == 0);
+    assert(dictionary_set(site, "net", NULL) == 0);
+    assert(dictionary_set(site, "net:port", "8080") == 0);
+    assert(dictionary_set(site, "net:tls", "yes") == 0);
+
+    /* layers[0] 在最底層 */
+    struct dictionary *layers[] = { defaults, site };
+    struct dictionary *o = dictionary_overlay(layers, 2);
+    assert(o);
+    assert(strcmp(dictionary_get(o, "net:port", ""), "8080") == 0);
+    assert(strcmp(dictionary_get(o, "net:host", ""), "localhost") == 0);
+    assert(strcmp(dictionary_get(o, "net:tls", ""), "yes") == 0);
+
+    /* 寫入只進最上層，刪除以 tombstone 遮住下層 */
+    assert(dictionary_set(o, "net:port", "443") == 0);
+    dictionary_unset(o, "net:host");
+    dictionary_unset(o, "log:level");
+    dictionary_unset(o, "log");
+    assert(strcmp(dictionary_get(o, "net:port", ""), "443") == 0);
+    assert(strcmp(dictionary_get(site, "net:port", ""), "8080") == 0);
+    assert(!dictionary_get(o, "net:host", NULL));
+    assert(strcmp(dictionary_get(defaults, "net:host", ""), "localhost") == 0);
+    assert(strcmp(dictionary_get(o, "log", "missing"), "missing") == 0);
+
+    /* 合併後的檢視：每個 key 只出現一次 */
+    int n = 0;
+    struct dictionary_iter it;
+    const char *k, *v;
+    dictionary_iter_init(&it, o);
+    while (dictionary_iter_next(&it, &k, &v)) {
+        assert(strcmp(k, "net:host") != 0 && strncmp(k, "log", 3) != 0);
+        n++;
+    }
+    assert(n == 3);
+
+    /* 再次寫入會移除 tombstone；下層的變更會直接反映 */
+    assert(dictionary_set(o, "net:host", "example.org") == 0);
+    assert(strcmp(dictionary_get(o, "net:host", ""), "example.org") == 0);
+    assert(dictionary_set(defaults, "net:timeout", "30") == 0);
+    assert(strcmp(dictionary_get(o, "net:timeout", ""), "30") == 0);
+    dictionary_unset(o, "net:port");
+    assert(!dictionary_get(o, "net:port", NULL));
+
+    /* overlay 不能再當作 layer */
+    struct dictionary *nested[] = { o };
+    assert(dictionary_overlay(nested, 1) == NULL);
+
+    /* 複製後各自獨立 */
+    struct dictionary *c = dictionary_clone(o);
+    assert(c);
+    dictionary_unset(c, "net:tls");
+    assert(!dictionary_get(c, "net:tls", NULL));
+    assert(strcmp(dictionary_get(o, "net:tls", ""), "yes") == 0);
+    dictionary_del(c);
+
+    dictionary_del(o);
+    dictionary_del(site);
+    dictionary_del(defaults);
+}
+
+static int trace_begins;
+static int trace_ends;
+static void trace_begin(const char *name, const void *obj)
+{
+    (void)name; (void)obj;
+    trace_begins++;
+}
+static void trace_end(const char *name, const void *obj)
+{
+    (void)name; (void)obj;
+    trace_ends++;
+}
+
+void test_dictionary_stats(void)
+{
+    struct dictionary_stats st;
+    struct dictionary *dict = dictionary_new(0);
+
+    dictionary_set_trace_hooks(trace_begin, trace_end);
+    dictionary_stats_reset();
+    assert(dictionary_set(dict, "a", "1") == 0);
+    assert(dictionary_get(dict, "a", NULL) != NULL);
+    assert(dictionary_get(dict, "missing", NULL) == NULL);
+    FILE *fp = fopen("test_stats.ini", "w");
+    assert(fp);
+    dictionary_dump(dict, fp);
+    fclose(fp);
+    remove("test_stats.ini");
+
+#ifdef DICTIONARY_STATS
+    assert(dictionary_stats_get(&st) == 0);
+    assert(st.get_hits == 1);
+    assert(st.get_misses == 1);
+    assert(st.allocs == 1); /* short strings are stored inside the bucket */
+    assert(trace_begins > 0 && trace_begins == trace_ends);
+#else
+    /* Without the counters compiled in the API exists but reports -1 */
+    assert(dictionary_stats_get(&st) == -1);
+    assert(trace_begins == 0 && trace_ends == 0);
+#endif
+    dictionary_set_trace_hooks(NULL, NULL);
+    dictionary_del(dict);
+}
+
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <assert.h>
 #include <math.h>
+#include <locale.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
 #include "iniparser.h"
+#include "iniparser_async.h"
+#include "iniparser_watch.h"
+#include "dictionary_image.h"
 
 #define EPS 1e-6 /*⎯ small tolerance when comparing doubles ⎯*/
 
@@ -299,6 +824,1043 @@ static void test_getseckeys(void)
     remove(filename);
 }
 
+static void test_binary_snapshot(void)
+{
+    const char *filename = create_sample_file("sample_snap.ini");
+    struct dictionary *d = iniparser_load(filename);
+    assert(d);
+
+    FILE *fp = fopen("sample.snap", "w+b");
+    assert(fp);
+    assert(dictionary_save_binary(d, fp) == 0);
+    rewind(fp);
+    struct dictionary *s = dictionary_load_binary(fp);
+    fclose(fp);
+    assert(s);
+
+    /* 載入後內容與原字典一致 */
+    assert(s->numOfElements == d->numOfElements);
+    assert(strcmp(iniparser_getstring(s, "general:name", NULL), "ChatGPT") == 0);
+    assert(iniparser_getint(s, "general:hex", -1) == 42);
+    assert(iniparser_getnsec(s) == 2);
+    assert(iniparser_find_entry(s, "paths") == 1);
+    assert(iniparser_getstring(s, "paths", "def") == NULL);
+
+    /* 載入的字典仍可修改 */
+    assert(iniparser_set(s, "general:name", "a value too long for the inline buffer") == 0);
+    assert(iniparser_set(s, "general:new", "1") == 0);
+    iniparser_unset(s, "paths:temp");
+    assert(iniparser_find_entry(s, "paths:temp") == 0);
+    assert(strcmp(iniparser_getstring(s, "general:name", NULL),
+                  "a value too long for the inline buffer") == 0);
+    iniparser_freedict(s);
+
+    /* 損毀的映像必須被拒絕 */
+    fp = fopen("sample.snap", "r+b");
+    assert(fp);
+    fseek(fp, -2, SEEK_END);
+    fputc('X', fp);
+    rewind(fp);
+    assert(dictionary_load_binary(fp) == NULL);
+    fclose(fp);
+
+    iniparser_freedict(d);
+    remove("sample.snap");
+    remove(filename);
+}
+
+static void test_mapped_snapshot(void)
+{
+    const char *filename = create_sample_file("sample_map.ini");
+    struct dictionary *d = iniparser_load(filename);
+    assert(d);
+
+    FILE *fp = fopen("sample_map.snap", "wb");
+    assert(fp);
+    assert(dictionary_save_binary(d, fp) == 0);
+    fclose(fp);
+    iniparser_freedict(d);
+
+    struct dictionary *m = dictionary_open_mapped("sample_map.snap");
+    assert(m);
+
+    /* 既有的 iniparser 存取函式直接讀取映射內容 */
+    assert(strcmp(iniparser_getstring(m, "general:name", NULL), "ChatGPT") == 0);
+    assert(iniparser_getint(m, "general:oct", -1) == 42);
+    assert(iniparser_getboolean(m, "general:active", 0) == 1);
+    assert(strcmp(iniparser_getstring(m, "general:nope", "def"), "def") == 0);
+    assert(iniparser_getnsec(m) == 2);
+    assert(iniparser_getsecnkeys(m, "paths") == 2);
+
+    const char *buf[2];
+    assert(iniparser_getseckeys(m, "paths", buf) != NULL);
+
+    /* 唯讀 */
+    assert(iniparser_set(m, "general:name", "x") == -1);
+    assert(strcmp(iniparser_getstring(m, "general:name", NULL), "ChatGPT") == 0);
+
+    iniparser_freedict(m);
+    assert(dictionary_open_mapped(filename) == NULL);   /* 不是映像檔 */
+    remove("sample_map.snap");
+    remove(filename);
+}
+
+static void test_shm_dictionary(void)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/dict_test_%ld", (long)getpid());
+
+    struct dictionary *d = dictionary_new(0);
+    assert(iniparser_set(d, "server", NULL) == 0);
+    assert(iniparser_set(d, "server:threads", "8") == 0);
+    assert(dictionary_shm_publish(d, name) == 0);
+
+    /* 子行程透過共享記憶體讀取同一份設定 */
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        struct dictionary *s = dictionary_shm_open(name);
+        int ok = s && iniparser_getint(s, "server:threads", -1) == 8;
+        if (s)
+            dictionary_del(s);
+        _exit(ok ? 0 : 1);
+    }
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    /* 更新後：舊映射保持不變，重新開啟才看到新值 */
+    struct dictionary *old = dictionary_shm_open(name);
+    assert(old);
+    assert(iniparser_set(d, "server:threads", "16") == 0);
+    assert(dictionary_shm_publish(d, name) == 0);
+    struct dictionary *cur = dictionary_shm_open(name);
+    assert(cur);
+    assert(iniparser_getint(old, "server:threads", -1) == 8);
+    assert(iniparser_getint(cur, "server:threads", -1) == 16);
+    assert(iniparser_getnsec(cur) == 1);
+
+    dictionary_del(old);
+    dictionary_del(cur);
+    assert(dictionary_shm_unlink(name) == 0);
+    assert(dictionary_shm_open(name) == NULL);
+
+    /* 發布者剛 ftruncate()、尚未寫入 magic 時，讀者必須拒絕 */
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    assert(fd >= 0);
+    assert(ftruncate(fd, 4096) == 0);
+    close(fd);
+    assert(dictionary_shm_open(name) == NULL);
+    assert(dictionary_shm_unlink(name) == 0);
+    dictionary_del(d);
+}
+
+static void test_typed_cache(void)
+{
+    struct dictionary *d = dictionary_new(0);
+    assert(d);
+
+    assert(iniparser_set(d, "tune:threads", "0x10") == 0);
+    assert(iniparser_set(d, "tune:ratio", "0.25") == 0);
+    assert(iniparser_set(d, "tune:on", "yes") == 0);
+    assert(iniparser_set(d, "tune:junk", "maybe") == 0);
+
+    for (int i = 0; i < 3; i++) {
+        assert(iniparser_getint(d, "tune:threads", -1) == 16);
+        assert(fabs(iniparser_getdouble(d, "tune:ratio", -1.0) - 0.25) < EPS);
+        assert(iniparser_getboolean(d, "tune:on", -1) == 1);
+        assert(iniparser_getboolean(d, "tune:junk", -1) == -1);
+        assert(iniparser_getboolean(d, "tune:junk", 7) == 7);
+    }
+    /* 同一 key 以其他型別讀取仍正確 */
+    assert(iniparser_getint64(d, "tune:threads", -1) == 16);
+    assert(iniparser_getuint64(d, "tune:threads", 0) == 16);
+    assert(iniparser_getlongint(d, "tune:threads", -1) == 16);
+
+#ifdef DICTIONARY_STATS
+    struct dictionary_stats st;
+    dictionary_stats_reset();
+    assert(iniparser_getint(d, "tune:threads", -1) == 16);
+    assert(fabs(iniparser_getdouble(d, "tune:ratio", -1.0) - 0.25) < EPS);
+    assert(dictionary_stats_get(&st) == 0);
+    assert(st.ini_conversions == 0);
+#endif
+
+    /* set 之後快取失效 */
+    assert(iniparser_set(d, "tune:threads", "32") == 0);
+    assert(iniparser_getint(d, "tune:threads", -1) == 32);
+    assert(iniparser_set(d, "tune:on", "false") == 0);
+    assert(iniparser_getboolean(d, "tune:on", -1) == 0);
+    assert(iniparser_set(d, "tune:ratio", NULL) == 0);
+    assert(fabs(iniparser_getdouble(d, "tune:ratio", -1.0) + 1.0) < EPS);
+
+    iniparser_freedict(d);
+}
+
+static void test_numeric_parsing(void)
+{
+    struct dictionary *d = dictionary_new(0);
+    const char *ints[] = { "42", "  -17", "+0x1f", "0X7fffffff", "0755", "08",
+                           "0x", "12abc", "", "-", "9223372036854775807",
+                           "9223372036854775808", "-9223372036854775808",
+                           "-9223372036854775809", "18446744073709551615",
+                           "18446744073709551616", "-1", "0xffffffffffffffffff" };
+    const char *dbls[] = { "3.1415926535", "-0.0", "1e10", "2.5E-3", ".5", "5.",
+                           "1e22", "1e23", "123456789012345678901234", "4.9e-324",
+                           "1.7976931348623157e308", "1e400", "0x1.8p1", "inf",
+                           "-nan", "  7.25xyz", "abc", "0.1", "9007199254740993" };
+    char key[32];
+
+    for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+        snprintf(key, sizeof(key), "n:i%zu", i);
+        assert(iniparser_set(d, key, ints[i]) == 0);
+        assert(iniparser_getlongint(d, key, 0) == strtol(ints[i], NULL, 0));
+        assert(iniparser_getint64(d, key, 0) == strtoimax(ints[i], NULL, 0));
+        assert(iniparser_getuint64(d, key, 0) == strtoumax(ints[i], NULL, 0));
+    }
+    for (size_t i = 0; i < sizeof(dbls) / sizeof(dbls[0]); i++) {
+        double a, b = strtod(dbls[i], NULL);
+        snprintf(key, sizeof(key), "n:d%zu", i);
+        assert(iniparser_set(d, key, dbls[i]) == 0);
+        a = iniparser_getdouble(d, key, -1.0);
+        assert((isnan(a) && isnan(b)) || memcmp(&a, &b, sizeof(a)) == 0);
+    }
+
+    /* 與 strtod 逐位元比對隨機數值 */
+    srand(12345);
+    for (int i = 0; i < 20000; i++) {
+        char val[64];
+        double x = (double)rand() / RAND_MAX * pow(10, rand() % 40 - 20);
+        snprintf(val, sizeof(val), (i & 1) ? "%.17g" : "%.6g", x);
+        assert(iniparser_set(d, "n:r", val) == 0);
+        double a = iniparser_getdouble(d, "n:r", -1.0), b = strtod(val, NULL);
+        assert(memcmp(&a, &b, sizeof(a)) == 0);
+    }
+
+    /* checked 版本 */
+    int iv;
+    long lv;
+    int64_t i64;
+    uint64_t u64;
+    double dv;
+    assert(iniparser_set(d, "c:ok", " 0x10 ") == 0);
+    assert(iniparser_set(d, "c:junk", "12abc") == 0);
+    assert(iniparser_set(d, "c:big", "4294967296") == 0);
+    assert(iniparser_set(d, "c:neg", "-3") == 0);
+    assert(iniparser_set(d, "c:dbl", "2.5e-3") == 0);
+    assert(iniparser_set(d, "c:huge", "1e400") == 0);
+    assert(iniparser_set(d, "c:null", NULL) == 0);
+
+    assert(iniparser_getint_checked(d, "c:ok", &iv) == INIPARSER_OK && iv == 16);
+    assert(iniparser_getint_checked(d, "c:junk", &iv) == INIPARSER_ESYNTAX);
+    assert(iniparser_getint_checked(d, "c:big", &iv) == INIPARSER_ERANGE);
+    assert(iniparser_set(d, "c:small", "-4294967296") == 0);
+    assert(iniparser_getint(d, "c:big", -1) == INT_MAX);
+    assert(iniparser_getint(d, "c:small", -1) == INT_MIN);
+    assert(iniparser_getlongint_checked(d, "c:neg", &lv) == INIPARSER_OK && lv == -3);
+    assert(iniparser_getint64_checked(d, "c:big", &i64) == INIPARSER_OK && i64 == 4294967296LL);
+    assert(iniparser_getuint64_checked(d, "c:neg", &u64) == INIPARSER_ERANGE);
+    assert(iniparser_getuint64_checked(d, "c:missing", &u64) == INIPARSER_ENOTFOUND);
+    assert(iniparser_getint_checked(d, "c:null", &iv) == INIPARSER_ENOTFOUND);
+    assert(iniparser_getdouble_checked(d, "c:dbl", &dv) == INIPARSER_OK && dv == 2.5e-3);
+    assert(iniparser_getdouble_checked(d, "c:huge", &dv) == INIPARSER_ERANGE);
+    assert(iniparser_getdouble_checked(d, "c:junk", &dv) == INIPARSER_ESYNTAX);
+
+    /* 與 locale 無關 */
+    if (setlocale(LC_NUMERIC, "de_DE.UTF-8") || setlocale(LC_NUMERIC, "fr_FR.UTF-8")) {
+        assert(fabs(iniparser_getdouble(d, "c:dbl", -1.0) - 2.5e-3) < EPS);
+        assert(iniparser_set(d, "c:long", "3.14159265358979323846264338327950288") == 0);
+        assert(fabs(iniparser_getdouble(d, "c:long", -1.0) - 3.14159265358979) < EPS);
+        /* 長尾數走慢速路徑，小數點仍只能是 '.' */
+        assert(iniparser_set(d, "c:comma", "12345678901234567890,5") == 0);
+        assert(iniparser_getdouble_checked(d, "c:comma", &dv) == INIPARSER_ESYNTAX);
+        setlocale(LC_NUMERIC, "C");
+    }
+
+    iniparser_freedict(d);
+}
+
+static void test_key_handles(void)
+{
+    struct dictionary *d = dictionary_new(0);
+    assert(d);
+    iniparser_key_t threads = iniparser_key("Server:Threads");
+    iniparser_key_t ratio = iniparser_key("server:ratio");
+    iniparser_key_t on = iniparser_key("server:on");
+    iniparser_key_t name = iniparser_key("server:name");
+    iniparser_key_t none = iniparser_key("server:none");
+    assert(threads && ratio && on && name && none);
+    assert(iniparser_key(NULL) == NULL);
+
+    assert(iniparser_set(d, "server:threads", "8") == 0);
+    assert(iniparser_set(d, "server:ratio", "0.5") == 0);
+    assert(iniparser_set(d, "server:on", "true") == 0);
+    assert(iniparser_set(d, "server:name", "web") == 0);
+
+    for (int i = 0; i < 3; i++) {
+        assert(iniparser_getint_h(d, threads, -1) == 8);
+        assert(iniparser_getlongint_h(d, threads, -1) == 8);
+        assert(iniparser_getint64_h(d, threads, -1) == 8);
+        assert(iniparser_getuint64_h(d, threads, 0) == 8);
+        assert(fabs(iniparser_getdouble_h(d, ratio, -1.0) - 0.5) < EPS);
+        assert(iniparser_getboolean_h(d, on, -1) == 1);
+        assert(strcmp(iniparser_getstring_h(d, name, NULL), "web") == 0);
+        assert(strcmp(iniparser_getstring_h(d, none, "def"), "def") == 0);
+        assert(iniparser_getint_h(d, none, -7) == -7);
+    }
+    assert(iniparser_getint_h(NULL, threads, -1) == -1);
+    assert(iniparser_getint_h(d, NULL, -1) == -1);
+
+    /* 只改值時提示仍有效，且讀到新值 */
+    assert(iniparser_set(d, "server:threads", "16") == 0);
+    assert(iniparser_getint_h(d, threads, -1) == 16);
+    assert(iniparser_set(d, "server:name", "a much longer server name") == 0);
+    assert(strcmp(iniparser_getstring_h(d, name, NULL), "a much longer server name") == 0);
+
+    /* 新增、刪除與擴容都會使提示失效 */
+    char key[32];
+    for (int i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "server:k%d", i);
+        assert(iniparser_set(d, key, "x") == 0);
+    }
+    assert(iniparser_getint_h(d, threads, -1) == 16);
+    iniparser_unset(d, "server:threads");
+    assert(iniparser_getint_h(d, threads, -1) == -1);
+    assert(iniparser_set(d, "server:threads", "4") == 0);
+    assert(iniparser_getint_h(d, threads, -1) == 4);
+
+    /* 同一個 handle 可用於不同字典 */
+    struct dictionary *d2 = dictionary_new(0);
+    assert(d2);
+    assert(iniparser_set(d2, "server:threads", "2") == 0);
+    assert(iniparser_getint_h(d2, threads, -1) == 2);
+    assert(iniparser_getint_h(d, threads, -1) == 4);
+    iniparser_freedict(d2);
+
+    /* 映像字典 */
+    FILE *fp = fopen("sample_key.snap", "wb");
+    assert(fp);
+    assert(dictionary_save_binary(d, fp) == 0);
+    fclose(fp);
+    struct dictionary *m = dictionary_open_mapped("sample_key.snap");
+    assert(m);
+    assert(iniparser_getint_h(m, threads, -1) == 4);
+    assert(iniparser_getboolean_h(m, on, -1) == 1);
+    assert(strcmp(iniparser_getstring_h(m, none, "def"), "def") == 0);
+    iniparser_freedict(m);
+    remove("sample_key.snap");
+
+    iniparser_key_free(threads);
+    iniparser_key_free(ratio);
+    iniparser_key_free(on);
+    iniparser_key_free(name);
+    iniparser_key_free(none);
+    iniparser_key_free(NULL);
+    iniparser_freedict(d);
+}
+
+struct bind_cfg {
+    int threads;
+    long int level;
+    int64_t offset;
+    uint64_t limit;
+    double ratio;
+    int debug;
+    const char *name;
+};
+
+/* 與 tools/inibind 產生的表格相同的形式 */
+static const struct iniparser_binding bind_fields[] = {
+    { "server:threads", INIPARSER_TYPE_INT, offsetof(struct bind_cfg, threads), "4" },
+    { "log:level", INIPARSER_TYPE_LONG, offsetof(struct bind_cfg, level), "-3" },
+    { "server:offset", INIPARSER_TYPE_INT64, offsetof(struct bind_cfg, offset), "0" },
+    { "server:limit", INIPARSER_TYPE_UINT64, offsetof(struct bind_cfg, limit), "0xffffffffffffffff" },
+    { "server:ratio", INIPARSER_TYPE_DOUBLE, offsetof(struct bind_cfg, ratio), NULL },
+    { "server:debug", INIPARSER_TYPE_BOOL, offsetof(struct bind_cfg, debug), "no" },
+    { "server:name", INIPARSER_TYPE_STRING, offsetof(struct bind_cfg, name), "front" },
+};
+#define NBIND (sizeof(bind_fields) / sizeof(bind_fields[0]))
+
+static void test_bind(void)
+{
+    struct dictionary *d = dictionary_new(0);
+    struct bind_cfg cfg;
+    assert(d);
+
+    /* 缺少必要的鍵 */
+    memset(&cfg, 0, sizeof(cfg));
+    assert(iniparser_bind(d, bind_fields, NBIND, &cfg) == INIPARSER_ENOTFOUND);
+    assert(cfg.threads == 4 && cfg.level == -3 && cfg.limit == UINT64_MAX);
+    assert(cfg.debug == 0 && strcmp(cfg.name, "front") == 0);
+
+    assert(iniparser_set(d, "server", NULL) == 0);
+    assert(iniparser_set(d, "server:ratio", "0.5") == 0);
+    assert(iniparser_set(d, "server:threads", "0x10") == 0);
+    assert(iniparser_set(d, "server:debug", "Yes") == 0);
+    assert(iniparser_set(d, "server:name", "back end") == 0);
+    assert(iniparser_bind(d, bind_fields, NBIND, &cfg) == INIPARSER_OK);
+    assert(cfg.threads == 16 && fabs(cfg.ratio - 0.5) < EPS && cfg.debug == 1);
+    assert(strcmp(cfg.name, "back end") == 0);
+
+    /* 錯誤的值不會改動欄位，其餘欄位照常處理 */
+    assert(iniparser_set(d, "server:threads", "many") == 0);
+    assert(iniparser_set(d, "server:offset", "9223372036854775808") == 0);
+    assert(iniparser_set(d, "server:debug", "maybe") == 0);
+    assert(iniparser_set(d, "server:ratio", "0.25") == 0);
+    assert(iniparser_bind(d, bind_fields, NBIND, &cfg) == INIPARSER_ESYNTAX);
+    assert(cfg.threads == 16 && cfg.offset == 0 && cfg.debug == 1);
+    assert(fabs(cfg.ratio - 0.25) < EPS);
+    assert(iniparser_set(d, "server:threads", "99999999999") == 0);
+    assert(iniparser_set(d, "server:debug", "off") == 0);
+    assert(iniparser_bind(d, bind_fields, NBIND, &cfg) == INIPARSER_ERANGE);
+
+    assert(iniparser_bind(NULL, bind_fields, NBIND, &cfg) == INIPARSER_ENOTFOUND);
+    assert(iniparser_bind(d, bind_fields, 0, &cfg) == INIPARSER_OK);
+    iniparser_freedict(d);
+}
+
+static void test_embedded_image(void)
+{
+    const char *filename = create_sample_file("sample_embed.ini");
+    struct dictionary *d = iniparser_load(filename);
+    assert(d);
+
+    /* 每個 key 各佔一個 bucket 的 perfect hash */
+    size_t len;
+    void *img = dict_image_build_perfect(d, &len);
+    assert(img && dict_image_check(img, len) == 0);
+    const struct dict_image_header *h = img;
+    unsigned int nb = h->nbuckets;
+    assert(h->ngroups && nb <= d->numOfElements + d->numOfElements / 8 + 1);
+    const uint32_t *heads = DICT_IMAGE_HEADS(h);
+    const struct dict_image_entry *e = DICT_IMAGE_ENTRIES(h);
+    for (uint32_t i = 0; i < h->nentries; i++)
+        assert(e[i].next == 0 && heads[dict_image_slot(h, e[i].hash)] == i + 1);
+
+    /* 與 iniembed 產生的程式碼相同的靜態字典 */
+    const struct dictionary view = DICT_IMAGE_STATIC(h, nb, d->numOfElements);
+    assert(strcmp(iniparser_getstring(&view, "general:name", NULL), "ChatGPT") == 0);
+    assert(iniparser_getint(&view, "general:hex", -1) == 42);
+    assert(iniparser_getnsec(&view) == iniparser_getnsec(d));
+    assert(strcmp(iniparser_getstring(&view, "general:nope", "def"), "def") == 0);
+
+#ifdef DICTIONARY_STATS
+    struct dictionary_stats st;
+    dictionary_stats_reset();
+    assert(iniparser_getint(&view, "general:answer", -1) == 42);
+    assert(strcmp(iniparser_getstring(&view, "paths:home", ""), "") != 0);
+    assert(dictionary_stats_get(&st) == 0);
+    assert(st.probes == 2 && st.allocs == 0);
+#endif
+
+    /* 大量的 key：bucket 數接近 key 數，載入後仍可查詢 */
+    struct dictionary *big = dictionary_new(0);
+    char key[32];
+    for (int i = 0; i < 8001; i++) {
+        snprintf(key, sizeof(key), "section:key%d", i);
+        assert(dictionary_set(big, key, key + 8) == 0);
+    }
+    size_t blen;
+    void *bimg = dict_image_build_perfect(big, &blen);
+    assert(bimg && dict_image_check(bimg, blen) == 0);
+    const struct dict_image_header *bh = bimg;
+    assert(bh->nbuckets <= 8001 + 8001 / 8 + 1);
+    struct dictionary *bview = dict_image_view(bimg, blen);
+    FILE *bf = tmpfile();
+    assert(bview && bf && fwrite(bimg, 1, blen, bf) == blen);
+    rewind(bf);
+    struct dictionary *bload = dictionary_load_binary(bf);
+    assert(bload);
+    assert(strcmp(dictionary_get(bview, "section:key4711", ""), "key4711") == 0);
+    assert(strcmp(dictionary_get(bload, "section:key4711", ""), "key4711") == 0);
+    assert(!dictionary_get(bview, "section:key8001", NULL));
+    fclose(bf);
+    dictionary_del(bload);
+    dictionary_del(bview);
+    free(bimg);
+    dictionary_del(big);
+    assert(dict_image_build_perfect(NULL, &blen) == NULL);
+
+    free(img);
+    iniparser_freedict(d);
+    remove(filename);
+}
+
+static void test_lookup_cache(void)
+{
+    struct dictionary *d = dictionary_new(0);
+    assert(d);
+    assert(iniparser_set_lookup_cache(1) == 0);
+
+    assert(iniparser_set(d, "srv:threads", "8") == 0);
+    assert(iniparser_set(d, "srv:name", "front") == 0);
+    for (int i = 0; i < 3; i++) {
+        assert(iniparser_getint(d, "srv:threads", -1) == 8);
+        assert(strcmp(iniparser_getstring(d, "SRV:Name", NULL), "front") == 0);
+    }
+#ifdef DICTIONARY_STATS
+    struct dictionary_stats st;
+    dictionary_stats_reset();
+    assert(iniparser_getint(d, "srv:threads", -1) == 8);
+    assert(strcmp(iniparser_getstring(d, "SRV:Name", NULL), "front") == 0);
+    assert(dictionary_stats_get(&st) == 0);
+    assert(st.ini_cache_hits == 2 && st.probes == 0);
+#endif
+
+    /* 改值後命中仍回傳新值；刪除與新增使快取失效 */
+    assert(iniparser_set(d, "srv:threads", "16") == 0);
+    assert(iniparser_getint(d, "srv:threads", -1) == 16);
+    iniparser_unset(d, "srv:threads");
+    assert(iniparser_getint(d, "srv:threads", -1) == -1);
+    assert(iniparser_set(d, "srv:threads", "4") == 0);
+    assert(iniparser_getint(d, "srv:threads", -1) == 4);
+
+    /* 同一個緩衝區放入不同的 key */
+    char key[32];
+    strcpy(key, "srv:threads");
+    assert(iniparser_getint(d, key, -1) == 4);
+    strcpy(key, "srv:name");
+    assert(strcmp(iniparser_getstring(d, key, NULL), "front") == 0);
+    strcpy(key, "srv:nope");
+    assert(iniparser_getstring(d, key, NULL) == NULL);
+
+    /* 同一個 key 指標用於另一個字典 */
+    struct dictionary *d2 = dictionary_new(0);
+    assert(d2);
+    assert(iniparser_set(d2, "srv:threads", "2") == 0);
+    assert(iniparser_getint(d2, "srv:threads", -1) == 2);
+    assert(iniparser_getint(d, "srv:threads", -1) == 4);
+    iniparser_freedict(d2);
+    d2 = dictionary_new(0);
+    assert(d2);
+    assert(iniparser_getint(d2, "srv:threads", -1) == -1);
+    iniparser_freedict(d2);
+
+    assert(iniparser_set_lookup_cache(0) == 1);
+    assert(iniparser_getint(d, "srv:threads", -1) == 4);
+    iniparser_freedict(d);
+}
+
+struct async_result {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int done;
+    int err;
+    struct dictionary *d;
+};
+
+static void async_done(struct dictionary *d, int err, void *ctx)
+{
+    struct async_result *r = ctx;
+    pthread_mutex_lock(&r->lock);
+    r->d = d;
+    r->err = err;
+    r->done++;
+    pthread_cond_signal(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+}
+
+static void async_wait(struct async_result *r)
+{
+    pthread_mutex_lock(&r->lock);
+    while (!r->done)
+        pthread_cond_wait(&r->cond, &r->lock);
+    pthread_mutex_unlock(&r->lock);
+}
+
+/* 只記下工作、由測試決定何時執行的 executor */
+struct queued_task {
+    void (*task)(void *);
+    void *arg;
+};
+
+static int queue_submit(void (*task)(void *), void *arg, void *ctx)
+{
+    struct queued_task *q = ctx;
+    if (q->task)
+        return -1;
+    q->task = task;
+    q->arg = arg;
+    return 0;
+}
+
+static int inline_submit(void (*task)(void *), void *arg, void *ctx)
+{
+    (void)ctx;
+    task(arg);
+    return 0;
+}
+
+static void test_async_load(void)
+{
+    const char *filename = create_sample_file("sample_async.ini");
+    struct async_result r = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, -1, NULL };
+
+    /* 預設在背景執行緒載入 */
+    struct iniparser_load_op *op = iniparser_load_async(filename, NULL, async_done, &r);
+    assert(op);
+    async_wait(&r);
+    iniparser_load_op_free(op);
+    assert(r.done == 1 && r.err == 0 && r.d);
+    assert(strcmp(iniparser_getstring(r.d, "general:name", NULL), "ChatGPT") == 0);
+    iniparser_freedict(r.d);
+
+    r.done = 0;
+    op = iniparser_load_async("no_such_file.ini", NULL, async_done, &r);
+    assert(op);
+    iniparser_load_op_free(op);     /* 釋放 handle 不會取消載入 */
+    async_wait(&r);
+    assert(r.err == ENOENT && r.d == NULL);
+
+    /* 呼叫端提供的 executor，於執行前取消 */
+    struct queued_task q = { NULL, NULL };
+    struct iniparser_executor ex = { queue_submit, &q };
+    struct iniparser_async_opts opts = { &ex, 0 };
+    r.done = 0;
+    op = iniparser_load_async(filename, &opts, async_done, &r);
+    assert(op && q.task && !r.done);
+    assert(iniparser_load_async(filename, &opts, async_done, &r) == NULL);
+    iniparser_load_cancel(op);
+    q.task(q.arg);
+    assert(r.done == 1 && r.err == ECANCELED && r.d == NULL);
+    iniparser_load_op_free(op);
+
+    /* 同步執行的 executor：回呼在 load_async 返回前就已完成 */
+    ex.submit = inline_submit;
+    r.done = 0;
+    op = iniparser_load_async(filename, &opts, async_done, &r);
+    assert(op && r.done == 1 && r.err == 0 && r.d);
+    iniparser_load_cancel(op);      /* 已完成，不影響結果 */
+    iniparser_load_op_free(op);
+    iniparser_freedict(r.d);
+
+    FILE *fp = fopen("sample_async_bad.ini", "w");
+    assert(fp);
+    fputs("[s]\nthis line is not valid\n", fp);
+    fclose(fp);
+    r.done = 0;
+    op = iniparser_load_async("sample_async_bad.ini", &opts, async_done, &r);
+    assert(op && r.done == 1 && r.err == EINVAL && r.d == NULL);
+    iniparser_load_op_free(op);
+
+    assert(iniparser_load_async(NULL, NULL, async_done, &r) == NULL);
+    assert(iniparser_load_async(filename, NULL, NULL, NULL) == NULL);
+    remove("sample_async_bad.ini");
+    remove(filename);
+}
+
+static void write_file(const char *path, const char *text)
+{
+    FILE *fp = fopen(path, "w");
+    assert(fp);
+    fputs(text, fp);
+    fclose(fp);
+}
+
+static void test_load_dir(void)
+{
+    char dir[] = "/tmp/inidirXXXXXX";
+    char path[64];
+    assert(mkdtemp(dir));
+
+    /* 以檔名順序合併，後面的檔案覆寫前面的 */
+    snprintf(path, sizeof(path), "%s/20-local.ini", dir);
+    write_file(path, "[server]\nthreads = 16\n[log]\nlevel = debug\n");
+    snprintf(path, sizeof(path), "%s/10-base.ini", dir);
+    write_file(path, "[server]\nthreads = 4\nport = 80\n");
+    snprintf(path, sizeof(path), "%s/30-last.ini", dir);
+    write_file(path, "[server]\nport = 8080\n");
+    snprintf(path, sizeof(path), "%s/README", dir);
+    write_file(path, "not an ini file\n");
+    snprintf(path, sizeof(path), "%s/.hidden.ini", dir);
+    write_file(path, "[server]\nport = 1\n");
+    for (int i = 0; i < 80; i++) {
+        char text[64];
+        snprintf(path, sizeof(path), "%s/15-frag%02d.ini", dir, i);
+        snprintf(text, sizeof(text), "[frag%d]\nkey = %d\n", i, i);
+        write_file(path, text);
+    }
+
+    struct iniparser_async_opts opts = { NULL, 0 };
+    struct dictionary *d;
+    for (unsigned t = 0; t < 4; t++) {
+        opts.threads = t * 3;
+        d = iniparser_load_dir(dir, NULL, t ? &opts : NULL);
+        assert(d);
+        assert(iniparser_getint(d, "server:threads", -1) == 16);
+        assert(iniparser_getint(d, "server:port", -1) == 8080);
+        assert(strcmp(iniparser_getstring(d, "log:level", ""), "debug") == 0);
+        assert(iniparser_getint(d, "frag39:key", -1) == 39);
+        assert(iniparser_getnsec(d) == 82);
+        iniparser_freedict(d);
+    }
+
+#ifdef DICTIONARY_STATS
+    /* 合併前已依總數配置好大小，不需要再擴充 */
+    struct dictionary_stats st;
+    opts.threads = 1;
+    dictionary_stats_reset();
+    d = iniparser_load_dir(dir, NULL, &opts);
+    assert(d && dictionary_stats_get(&st) == 0 && st.grows == 0);
+    iniparser_freedict(d);
+#endif
+
+    /* 呼叫端提供的 executor 與 pattern */
+    struct iniparser_executor ex = { inline_submit, NULL };
+    opts.executor = &ex;
+    opts.threads = 8;
+    d = iniparser_load_dir(dir, "[12]0-*.ini", &opts);
+    assert(d);
+    assert(iniparser_getint(d, "server:port", -1) == 80);
+    assert(iniparser_getnsec(d) == 2);
+    iniparser_freedict(d);
+
+    d = iniparser_load_dir(dir, "*.none", NULL);
+    assert(d && d->numOfElements == 0);
+    iniparser_freedict(d);
+
+    /* 任何一個檔案解析失敗則整體失敗 */
+    snprintf(path, sizeof(path), "%s/99-bad.ini", dir);
+    write_file(path, "[server]\nbroken line\n");
+    assert(iniparser_load_dir(dir, NULL, NULL) == NULL);
+    assert(iniparser_load_dir("/nonexistent-dir", NULL, NULL) == NULL);
+
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    assert(system(cmd) == 0);
+}
+
+static void test_include(void)
+{
+    char dir[] = "/tmp/iniincXXXXXX";
+    char path[64];
+    assert(mkdtemp(dir));
+
+    snprintf(path, sizeof(path), "%s/common.ini", dir);
+    write_file(path, "[db]\nhost = db.example.com\nport = 5432\n@include 'sub/log.ini'\n");
+    assert(snprintf(path, sizeof(path), "%s/sub", dir) > 0 && mkdir(path, 0755) == 0);
+    snprintf(path, sizeof(path), "%s/sub/log.ini", dir);
+    write_file(path, "[log]\nlevel = info\nfile = /var/log/app-with-a-long-name.log\n");
+    snprintf(path, sizeof(path), "%s/a.ini", dir);
+    write_file(path, "[db]\nport = 1\n@include common.ini\nuser = a\n[log]\nlevel = debug\n");
+    char a[64];
+    snprintf(a, sizeof(a), "%s/a.ini", dir);
+    snprintf(path, sizeof(path), "%s/b.ini", dir);
+    write_file(path, "  @include \"common.ini\"\n");
+    char b[64];
+    snprintf(b, sizeof(b), "%s/b.ini", dir);
+
+    /* 被引入的檔案自成一體：之後的鍵仍屬於引入前的 section */
+    struct dictionary *da = iniparser_load(a);
+    assert(da);
+    assert(iniparser_getint(da, "db:port", -1) == 5432);
+    assert(strcmp(iniparser_getstring(da, "db:user", ""), "a") == 0);
+    assert(strcmp(iniparser_getstring(da, "log:level", ""), "debug") == 0);
+    assert(strcmp(iniparser_getstring(da, "db:host", ""), "db.example.com") == 0);
+    assert(iniparser_getnsec(da) == 2);
+
+    /* 第二個檔案共用同一份解析結果，字串不複製 */
+    struct dictionary *db = iniparser_load(b);
+    assert(db);
+    const char *host = iniparser_getstring(da, "db:host", NULL);
+    const char *file = iniparser_getstring(da, "log:file", NULL);
+    assert(iniparser_getstring(db, "db:host", NULL) == host);
+    assert(iniparser_getstring(db, "log:file", NULL) == file);
+    assert(strcmp(iniparser_getstring(db, "log:level", ""), "info") == 0);
+
+    /* 清除快取或釋放其中一個字典後，另一個仍然有效 */
+    iniparser_include_cache_clear();
+    iniparser_freedict(da);
+    assert(strcmp(iniparser_getstring(db, "db:host", ""), "db.example.com") == 0);
+    iniparser_set(db, "db:host", "other");
+    assert(strcmp(iniparser_getstring(db, "db:host", ""), "other") == 0);
+    iniparser_unset(db, "log:file");
+
+    /* 被引入的檔案（包括間接引入）改變後重新解析 */
+    da = iniparser_load(a);
+    assert(da && iniparser_getstring(da, "log:file", NULL) != file);
+    snprintf(path, sizeof(path), "%s/sub/log.ini", dir);
+    write_file(path, "[log]\nlevel = warn\n");
+    struct dictionary *dc = iniparser_load(b);
+    assert(dc);
+    assert(strcmp(iniparser_getstring(dc, "log:level", ""), "warn") == 0);
+    assert(iniparser_getstring(dc, "log:file", NULL) == NULL);
+    assert(strcmp(iniparser_getstring(da, "log:file", ""), "/var/log/app-with-a-long-name.log") == 0);
+    iniparser_freedict(dc);
+    iniparser_freedict(db);
+    iniparser_freedict(da);
+
+    /* 循環引用、缺少的檔案與空路徑都是錯誤 */
+    write_file(path, "[log]\n@include ../b.ini\n");
+    assert(iniparser_load(b) == NULL);
+    write_file(path, "@include log.ini\n");
+    assert(iniparser_load(b) == NULL);
+    write_file(path, "@include missing.ini\n");
+    assert(iniparser_load(b) == NULL);
+    write_file(path, "@include\n");
+    assert(iniparser_load(b) == NULL);
+    write_file(path, "[log]\n");
+    assert((db = iniparser_load(b)) != NULL);
+    iniparser_freedict(db);
+    iniparser_include_cache_clear();
+
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    assert(system(cmd) == 0);
+}
+
+static void test_reload(void)
+{
+    const char *path = "reload.ini";
+    write_file(path, "[server]\nthreads = 4\nport = 80\nname = front-end-server-01\n"
+                     "[log]\nlevel = info\n");
+    struct dictionary *d = iniparser_load(path);
+    assert(d);
+    const char *name = iniparser_getstring(d, "server:name", NULL);
+    const char *threads = iniparser_getstring(d, "server:threads", NULL);
+    assert(name && threads);
+
+    /* 只套用差異，未變動的鍵保留原本的指標 */
+    struct watch_log log = { 0 };
+    assert(dictionary_watch(d, "server:", log_changes, &log) > 0);
+    struct iniparser_changes *changes = NULL;
+    write_file(path, "[server]\nthreads = 8\nname = front-end-server-01\nmode = fast\n"
+                     "[cache]\n");
+    assert(iniparser_reload(d, path, &changes) == 0);
+    assert(changes && changes->count == 6);
+    static const struct {
+        const char *key;
+        enum iniparser_change_type type;
+    } expect[] = {
+        { "cache", INIPARSER_CHANGE_ADDED },
+        { "log", INIPARSER_CHANGE_REMOVED },
+        { "log:level", INIPARSER_CHANGE_REMOVED },
+        { "server:mode", INIPARSER_CHANGE_ADDED },
+        { "server:port", INIPARSER_CHANGE_REMOVED },
+        { "server:threads", INIPARSER_CHANGE_UPDATED },
+    };
+    for (size_t i = 0; i < changes->count; i++) {
+        assert(strcmp(changes->change[i].key, expect[i].key) == 0);
+        assert(changes->change[i].type == expect[i].type);
+    }
+    iniparser_changes_free(changes);
+    /* 一次重新載入只通知一次 */
+    assert(log.calls == 1 && log.nkeys == 3);
+
+    assert(iniparser_getstring(d, "server:name", NULL) == name);
+    assert(iniparser_getint(d, "server:threads", -1) == 8);
+    assert(strcmp(iniparser_getstring(d, "server:mode", ""), "fast") == 0);
+    assert(iniparser_find_entry(d, "cache"));
+    assert(!iniparser_find_entry(d, "log") && !iniparser_find_entry(d, "server:port"));
+    assert(d->numOfElements == 5);
+
+    /* 沒有變化時回傳空清單 */
+    changes = (struct iniparser_changes *)1;
+    assert(iniparser_reload(d, path, &changes) == 0 && changes == NULL);
+    assert(iniparser_reload(d, path, NULL) == 0);
+
+    /* 無法讀取或解析時字典保持不變 */
+    write_file(path, "[server]\nbroken line\n");
+    assert(iniparser_reload(d, path, &changes) == -1 && changes == NULL);
+    assert(iniparser_reload(d, "no_such_file.ini", NULL) == -1);
+    assert(iniparser_getint(d, "server:threads", -1) == 8);
+    assert(d->numOfElements == 5);
+    iniparser_freedict(d);
+
+    /* 沒有訂閱者時不建立通知狀態 */
+    write_file(path, "[server]\nthreads = 2\n");
+    d = iniparser_load(path);
+    assert(d);
+    write_file(path, "[server]\nthreads = 3\n");
+    assert(iniparser_reload(d, path, NULL) == 0);
+    assert(d->watch == NULL && iniparser_getint(d, "server:threads", -1) == 3);
+
+    iniparser_freedict(d);
+    remove(path);
+}
+
+struct watch_events {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int count;
+    int err;
+};
+
+static void watch_notify(int err, void *ctx)
+{
+    struct watch_events *ev = ctx;
+    pthread_mutex_lock(&ev->lock);
+    ev->count++;
+    ev->err = err;
+    pthread_cond_signal(&ev->cond);
+    pthread_mutex_unlock(&ev->lock);
+}
+
+/* 等待第 n 次重新載入，回傳其錯誤碼 */
+static int watch_wait(struct watch_events *ev, int n)
+{
+    struct timespec limit;
+    clock_gettime(CLOCK_REALTIME, &limit);
+    limit.tv_sec += 10;
+    pthread_mutex_lock(&ev->lock);
+    while (ev->count < n)
+        assert(pthread_cond_timedwait(&ev->cond, &ev->lock, &limit) == 0);
+    int err = ev->err;
+    pthread_mutex_unlock(&ev->lock);
+    return err;
+}
+
+struct watch_reader {
+    struct iniparser_watch *w;
+    int stop;
+};
+
+static void *watch_reader_main(void *arg)
+{
+    struct watch_reader *r = arg;
+    while (!__atomic_load_n(&r->stop, __ATOMIC_RELAXED)) {
+        struct dict_snapshot *s = iniparser_watch_acquire(r->w);
+        /* 同一個版本內的值必須一致 */
+        assert(iniparser_getint(s->dict, "v:a", -1) == iniparser_getint(s->dict, "v:b", -2));
+        dict_snapshot_release(s);
+    }
+    return NULL;
+}
+
+static void test_watch(void)
+{
+    char dir[] = "/tmp/iniwatchXXXXXX";
+    char path[64];
+    char tmp[64];
+    assert(mkdtemp(dir));
+    snprintf(path, sizeof(path), "%s/app.ini", dir);
+    snprintf(tmp, sizeof(tmp), "%s/app.ini.new", dir);
+    write_file(path, "[v]\na = 0\nb = 0\n");
+
+    struct watch_events ev = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0 };
+    struct iniparser_watch_opts opts = { 20, NULL, watch_notify, &ev };
+    struct iniparser_watch *w = iniparser_watch_start(path, &opts);
+    assert(w);
+    struct dict_snapshot *old = iniparser_watch_acquire(w);
+    assert(iniparser_getint(old->dict, "v:a", -1) == 0);
+
+    pthread_t readers[3];
+    struct watch_reader r = { w, 0 };
+    for (int i = 0; i < 3; i++)
+        assert(pthread_create(&readers[i], NULL, watch_reader_main, &r) == 0);
+
+    /* 直接覆寫或以 rename 取代都會觸發重新載入 */
+    for (int i = 1; i <= 4; i++) {
+        char text[32];
+        snprintf(text, sizeof(text), "[v]\na = %d\nb = %d\n", i, i);
+        if (i % 2) {
+            write_file(path, text);
+        } else {
+            write_file(tmp, text);
+            assert(rename(tmp, path) == 0);
+        }
+        assert(watch_wait(&ev, i) == 0);
+        struct dict_snapshot *s = iniparser_watch_acquire(w);
+        assert(iniparser_getint(s->dict, "v:a", -1) == i);
+        dict_snapshot_release(s);
+    }
+    __atomic_store_n(&r.stop, 1, __ATOMIC_RELAXED);
+    for (int i = 0; i < 3; i++)
+        pthread_join(readers[i], NULL);
+
+    /* 舊的快照在釋放前保持不變 */
+    assert(iniparser_getint(old->dict, "v:a", -1) == 0);
+    dict_snapshot_release(old);
+
+    /* 解析失敗時保留目前的版本；其他檔案的變動不觸發重新載入 */
+    snprintf(path, sizeof(path), "%s/other.ini", dir);
+    write_file(path, "[x]\n");
+    snprintf(path, sizeof(path), "%s/app.ini", dir);
+    write_file(path, "[v]\nbroken line\n");
+    assert(watch_wait(&ev, 5) == EINVAL);
+    struct dict_snapshot *s = iniparser_watch_acquire(w);
+    assert(iniparser_getint(s->dict, "v:a", -1) == 4);
+    assert(ev.count == 5);
+
+    /* 停止後快照仍然有效 */
+    iniparser_watch_stop(w);
+    assert(iniparser_getint(s->dict, "v:b", -1) == 4);
+    dict_snapshot_release(s);
+
+    /* 監看整個目錄 */
+    write_file(path, "[v]\na = 1\n");
+    opts.pattern = "*.ini";
+    w = iniparser_watch_start(dir, &opts);
+    assert(w);
+    snprintf(path, sizeof(path), "%s/zz.ini", dir);
+    write_file(path, "[v]\na = 2\n");
+    assert(watch_wait(&ev, 6) == 0);
+    s = iniparser_watch_acquire(w);
+    assert(iniparser_getint(s->dict, "v:a", -1) == 2);
+    assert(iniparser_find_entry(s->dict, "x"));
+    dict_snapshot_release(s);
+    iniparser_watch_stop(w);
+
+    /* 目錄被刪除時以 ENOENT 通知並停止監看，最後的版本仍可取得 */
+    char sub[64];
+    snprintf(sub, sizeof(sub), "%s/sub", dir);
+    assert(mkdir(sub, 0755) == 0);
+    snprintf(path, sizeof(path), "%s/a.ini", sub);
+    write_file(path, "[v]\na = 7\n");
+    int first = ev.count;
+    int n = first;
+    w = iniparser_watch_start(sub, &opts);
+    assert(w);
+    remove(path);
+    assert(rmdir(sub) == 0);
+    while (watch_wait(&ev, ++n) != ENOENT)
+        assert(n < first + 3);   /* 之前最多一次重新載入 */
+    s = iniparser_watch_acquire(w);
+    assert(s->dict);
+    dict_snapshot_release(s);
+    iniparser_watch_stop(w);
+    assert(ev.count == n);
+
+    assert(iniparser_watch_start("/nonexistent-dir/app.ini", NULL) == NULL);
+
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    assert(system(cmd) == 0);
+}
+
+static void test_overlay_sections(void)
+{
+    const char *filename = create_sample_file("sample_overlay.ini");
+    struct dictionary *base = iniparser_load(filename);
+    struct dictionary *local = dictionary_new(0);
+    assert(base && local);
+    assert(iniparser_set(local, "extra", NULL) == 0);
+    assert(iniparser_set(local, "extra:flag", "true") == 0);
+    assert(iniparser_set(local, "paths:home", "/srv") == 0);
+
+    struct dictionary *layers[] = { base, local };
+    struct dictionary *o = dictionary_overlay(layers, 2);
+    assert(o);
+    int nsec = iniparser_getnsec(base);
+    assert(iniparser_getnsec(o) == nsec + 1);
+    assert(strcmp(iniparser_getstring(o, "Paths:Home", ""), "/srv") == 0);
+    assert(iniparser_getboolean(o, "extra:flag", 0) == 1);
+
+    /* 遮住的 key 不會出現在 section 中 */
+    iniparser_unset(o, "paths:temp");
+    assert(iniparser_find_entry(o, "paths:temp") == 0);
+    assert(iniparser_find_entry(base, "paths:temp") == 1);
+    assert(iniparser_getsecnkeys(o, "paths") == 1);
+    const char *keys[1];
+    assert(iniparser_getseckeys(o, "paths", keys) == keys);
+    assert(strcmp(keys[0], "paths:home") == 0);
+
+    dictionary_del(o);
+    dictionary_del(local);
+    iniparser_freedict(base);
+    remove(filename);
+}
+
 static void test_set_and_unset(void)
 {
     struct dictionary *d = dictionary_new(0);
@@ -321,11 +1883,35 @@ int main(void) {
     test_error_input();
     test_collision();
     test_dictionary_dump("test_dump.ini");
+    test_dictionary_stats();
+    test_inline_storage();
+    test_inplace_update();
+    test_value_interning();
+    test_dict_root();
+    test_dictionary_watch();
+    test_dictionary_clone();
+    test_dictionary_overlay();
+    test_dictionary_bulk();
     printf("All dictionary test passed!\n");
 
     test_basic_load_and_query();
     test_getseckeys();
     test_set_and_unset();
+    test_binary_snapshot();
+    test_mapped_snapshot();
+    test_shm_dictionary();
+    test_typed_cache();
+    test_numeric_parsing();
+    test_key_handles();
+    test_bind();
+    test_embedded_image();
+    test_lookup_cache();
+    test_async_load();
+    test_load_dir();
+    test_include();
+    test_reload();
+    test_watch();
+    test_overlay_sections();
     printf("All iniparser test passed!\n");
   return 0;
 }
@@ -0,0 +1,262 @@
+#include "iniparser.hpp"
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <string>
+#include <system_error>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+using namespace std::literals;
+
+static const char *create_sample_file(const char *path)
+{
+    FILE *fp = std::fopen(path, "w");
+    assert(fp && "fopen() failed");
+    std::fputs("[Server]\n"
+               "Threads = 8\n"
+               "Port    = 0x1f90\n"
+               "Mask    = 0755\n"
+               "Ratio   = 0.75\n"
+               "Debug   = yes\n"
+               "Name    = front\n"
+               "Big     = 300\n"
+               "Neg     = -5\n"
+               "Junk    = 12abc\n"
+               "\n"
+               "[paths]\n"
+               "home = /home/user\n"
+               "tmp  = /tmp\n", fp);
+    std::fclose(fp);
+    return path;
+}
+
+static void test_ini_owner(void)
+{
+    static_assert(!std::is_copy_constructible_v<ini::Ini>);
+    static_assert(std::is_nothrow_move_constructible_v<ini::Ini>);
+
+    ini::Ini empty;
+    assert(!empty);
+    assert(!empty.get<int>("server:threads"));
+    assert(empty.get<int>("server:threads", 3) == 3);
+    assert(!empty.set("a:b", "c"));
+    assert(empty.sections().begin() == empty.sections().end());
+
+    ini::Ini a(dictionary_new(0));
+    assert(a && a.set("s") && a.set("s:k", "v"));
+    ini::Ini b(std::move(a));
+    assert(!a && b);
+    assert(b.value("s:k") == "v"sv);
+
+    /* move assignment 釋放原本的字典 */
+    ini::Ini c(dictionary_new(0));
+    c = std::move(b);
+    assert(!b && c.value("s:k") == "v"sv);
+
+    struct dictionary *raw = c.release();
+    assert(!c && raw);
+    iniparser_freedict(raw);
+
+    assert(!ini::Ini::load("no_such_file.ini"));
+}
+
+static void test_ini_get(void)
+{
+    const char *filename = create_sample_file("sample_cpp.ini");
+    ini::Ini ini = ini::Ini::load(filename);
+    assert(ini);
+
+    /* string_view 查詢，不需以 NUL 結尾 */
+    std::string_view longkey = "server:threads-and-more";
+    assert(ini.get<int>(longkey.substr(0, 14)) == 8);
+    assert(ini.get<int>("SERVER:Threads") == 8);
+
+    assert(ini.get<int>("server:port") == 8080);
+    assert(ini.get<unsigned>("server:mask") == 0755u);
+    assert(ini.get<std::int64_t>("server:neg") == -5);
+    assert(std::fabs(*ini.get<double>("server:ratio") - 0.75) < 1e-12);
+    assert(*ini.get<float>("server:ratio") == 0.75f);
+    assert(ini.get<bool>("server:debug") == true);
+    assert(ini.get<std::string_view>("server:name") == "front"sv);
+
+    /* 型別範圍外、格式錯誤或缺少時回傳空值 */
+    assert(!ini.get<std::int8_t>("server:big"));
+    assert(ini.get<std::int16_t>("server:big") == 300);
+    assert(!ini.get<unsigned>("server:neg"));
+    assert(!ini.get<int>("server:junk"));
+    assert(!ini.get<bool>("server:threads-x"));
+    assert(!ini.get<bool>("server:big"));
+    assert(!ini.get<int>("server:nope"));
+    assert(ini.get<int>("server:nope", 42) == 42);
+    assert(!ini.value("server"));  /* section 沒有值 */
+    assert(ini.contains("server") && ini.contains("paths:home"));
+    assert(!ini.contains("paths:nope"));
+
+    assert(ini.get<std::int64_t>("x:min", 0) == 0);
+    assert(ini.set("x") && ini.set("x:min", "-9223372036854775808"));
+    assert(ini.get<std::int64_t>("x:min") == INT64_MIN);
+    assert(ini.set("x:max", "18446744073709551615"));
+    assert(ini.get<std::uint64_t>("x:max") == UINT64_MAX);
+    assert(!ini.get<std::int64_t>("x:max"));
+
+    /* 過長的值與 iniparser_set() 一樣被截斷 */
+    std::string big(3000, 'z');
+    assert(ini.set("x:big", big));
+    assert(ini.value("x:big")->size() == ini::detail::key_max);
+    ini.unset("x:big");
+    assert(!ini.contains("x:big"));
+
+    std::remove(filename);
+}
+
+static void test_ini_iteration(void)
+{
+    const char *filename = create_sample_file("sample_cpp_iter.ini");
+    ini::Ini ini = ini::Ini::load(filename);
+    assert(ini);
+
+    int nsec = 0;
+    bool saw_server = false;
+    for (const auto &e : ini.sections()) {
+        assert(!e.value);
+        saw_server |= e.key == "server";
+        nsec++;
+    }
+    assert(nsec == iniparser_getnsec(ini.get()) && saw_server);
+
+    int nkeys = 0;
+    for (const auto &e : ini.keys("Paths")) {
+        assert(e.key.substr(0, 6) == "paths:");
+        assert(e.value && ini.value(e.key) == *e.value);
+        nkeys++;
+    }
+    assert(nkeys == 2);
+
+    /* 前綴相同但不同 section 的鍵不應被列出 */
+    assert(ini.set("path") && ini.set("path:x", "1"));
+    nkeys = 0;
+    for (const auto &e : ini.keys(std::string("path"))) {
+        assert(e.key == "path:x");
+        nkeys++;
+    }
+    assert(nkeys == 1);
+    assert(ini.keys("nope").begin() == ini.keys("nope").end());
+
+    std::remove(filename);
+}
+
+static void test_hashed_keys(void)
+{
+    using namespace ini::literals;
+
+    /* 編譯期計算的雜湊必須與 dictionary_hash() 逐位元相同 */
+    static_assert(ini::hash("server:threads") == 1769030498u);
+    static_assert(ini::hash("caf\xc3\xa9:x") == 2431718356u);
+    constexpr auto k = "Server:Threads"_ikey;
+    static_assert(k.hash() == ini::hash("server:threads"));
+    static_assert(k.view() == "server:threads");
+
+    const char *samples[] = { "", "a", "server:threads", "paths:home", "UPPER:Case",
+                              "caf\xc3\xa9:x", "\x80\xff\x7f", "a:very:long:key:with:many:parts" };
+    for (const char *s : samples)
+        assert(ini::hash(s) == dictionary_hash(s));
+    char buf[2] = { 0, 0 };
+    for (int c = 1; c < 256; c++) {
+        buf[0] = (char)c;
+        assert(ini::hash(buf) == dictionary_hash(buf));
+    }
+
+    const char *filename = create_sample_file("sample_cpp_ikey.ini");
+    ini::Ini ini = ini::Ini::load(filename);
+    assert(ini);
+
+    assert(ini.get<int>("server:threads"_ikey) == 8);
+    assert(ini.get<int>("SERVER:PORT"_ikey) == 8080);
+    assert(ini.get<std::string_view>("paths:home"_ikey) == "/home/user"sv);
+    assert(ini.get<int>("server:nope"_ikey, 5) == 5);
+    assert(!ini.value("server"_ikey));
+    assert(ini.contains("server"_ikey) && !ini.contains("nope"_ikey));
+    assert(ini.set("server:threads", "12"));
+    assert(ini.get<int>(k) == 12);
+
+    /* 映像字典使用相同的雜湊 */
+    FILE *fp = std::fopen("sample_cpp_ikey.snap", "wb");
+    assert(fp);
+    assert(dictionary_save_binary(ini.get(), fp) == 0);
+    std::fclose(fp);
+    ini::Ini m(dictionary_open_mapped("sample_cpp_ikey.snap"));
+    assert(m);
+    assert(m.get<int>(k) == 12);
+    assert(m.contains("paths:tmp"_ikey));
+
+    std::remove("sample_cpp_ikey.snap");
+    std::remove(filename);
+}
+
+static void test_load_async(void)
+{
+    const char *filename = create_sample_file("sample_cpp_async.ini");
+
+    std::future<ini::Ini> f = ini::load_async(filename);
+    ini::Ini ini = f.get();
+    assert(ini && ini.get<int>("server:threads") == 8);
+
+    bool thrown = false;
+    try {
+        ini::load_async("no_such_file.ini").get();
+    } catch (const std::system_error &e) {
+        thrown = e.code().value() == ENOENT;
+    }
+    assert(thrown);
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+    /* 最小的 coroutine 型別，只為了測試 co_await */
+    struct task {
+        struct promise_type {
+            task get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+    struct outcome {
+        std::promise<int> threads;
+    } out;
+    auto run = [](const char *path, outcome &o) -> task {
+        try {
+            ini::Ini cfg = co_await ini::load_awaiter(path);
+            o.threads.set_value(cfg.get<int>("server:threads", -1));
+        } catch (const std::system_error &e) {
+            o.threads.set_value(-e.code().value());
+        }
+    };
+    auto got = out.threads.get_future();
+    run(filename, out);
+    assert(got.get() == 8);
+
+    outcome missing;
+    got = missing.threads.get_future();
+    run("no_such_file.ini", missing);
+    assert(got.get() == -ENOENT);
+#endif
+
+    std::remove(filename);
+}
+
+int main()
+{
+    test_ini_owner();
+    test_ini_get();
+    test_ini_iteration();
+    test_hashed_keys();
+    test_load_async();
+    std::printf("All C++ wrapper test passed!\n");
+    return 0;
+}
@@ -0,0 +1,259 @@
+/*
+ * inibind - generate a configuration struct and its binder from a schema.
+ *
+ *   inibind schema.ini name name.h name.c
+ *
+ * The schema is an ini file whose keys are the keys of the configuration
+ * and whose values give a type and, optionally, a default:
+ *
+ *   [server]
+ *   threads = int 4
+ *   ratio   = double 0.75
+ *   debug   = bool no
+ *   name    = string front end
+ *   port    = int            ; no default: the key is required
+ *
+ * Types are int, long, int64, uint64, double, bool and string. The output
+ * declares struct name, with one field per key named section_key, and
+ *
+ *   int name_bind(const struct dictionary *d, struct name *cfg);
+ *
+ * which fills it through iniparser_bind().
+ *
+ * Build from the repository root:
+ *   cc -I. -o inibind tools/inibind.c iniparser.c dictionary.c dictionary_image.c \
+ *      dictionary_watch.c -lpthread -lrt
+ */
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "iniparser.h"
+
+struct field {
+    const char *key;
+    const struct type *type;
+    const char *def;
+    char name[256];
+};
+
+static const struct type {
+    const char *name;
+    const char *ctype;
+    const char *tag;
+    enum iniparser_type type;
+} types[] = {
+    { "int",    "int",          "INIPARSER_TYPE_INT",    INIPARSER_TYPE_INT },
+    { "long",   "long int",     "INIPARSER_TYPE_LONG",   INIPARSER_TYPE_LONG },
+    { "int64",  "int64_t",      "INIPARSER_TYPE_INT64",  INIPARSER_TYPE_INT64 },
+    { "uint64", "uint64_t",     "INIPARSER_TYPE_UINT64", INIPARSER_TYPE_UINT64 },
+    { "double", "double",       "INIPARSER_TYPE_DOUBLE", INIPARSER_TYPE_DOUBLE },
+    { "bool",   "int",          "INIPARSER_TYPE_BOOL",   INIPARSER_TYPE_BOOL },
+    { "string", "const char *", "INIPARSER_TYPE_STRING", INIPARSER_TYPE_STRING },
+};
+
+static int by_key(const void *a, const void *b)
+{
+    return strcmp(((const struct field *)a)->key, ((const struct field *)b)->key);
+}
+
+static int is_ident(const char *s)
+{
+    if (!isalpha((unsigned char)*s) && *s != '_')
+        return 0;
+    for (; *s; s++)
+        if (!isalnum((unsigned char)*s) && *s != '_')
+            return 0;
+    return 1;
+}
+
+/* Splits "type default" and checks both; def points into spec */
+static int parse_spec(struct field *f, char *spec)
+{
+    char *p = spec;
+
+    while (*p && !isspace((unsigned char)*p))
+        p++;
+    if (*p) {
+        *p++ = '\0';
+        while (isspace((unsigned char)*p))
+            p++;
+    }
+    f->def = *p ? p : NULL;
+
+    f->type = NULL;
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+        if (strcmp(spec, types[i].name) == 0)
+            f->type = &types[i];
+    if (!f->type) {
+        fprintf(stderr, "inibind: %s: unknown type [%s]\n", f->key, spec);
+        return -1;
+    }
+    if (!f->def)
+        return 0;
+
+    /* The default must bind like a value read from a file would */
+    union {
+        int i;
+        long int l;
+        int64_t i64;
+        uint64_t u64;
+        double d;
+        const char *s;
+    } scratch;
+    struct iniparser_binding b = { "default", f->type->type, 0, NULL };
+    struct dictionary *d = dictionary_new(0);
+    int ret = d ? dictionary_set(d, "default", f->def) : -1;
+    if (ret == 0)
+        ret = iniparser_bind(d, &b, 1, &scratch);
+    dictionary_del(d);
+    if (ret != 0)
+        fprintf(stderr, "inibind: %s: bad default for %s\n", f->key, f->type->name);
+    return ret;
+}
+
+static void put_string(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            fprintf(out, "\\%c", *s);
+        else if (isprint((unsigned char)*s))
+            fputc(*s, out);
+        else
+            fprintf(out, "\\%03o", (unsigned char)*s);
+    }
+    fputc('"', out);
+}
+
+static int emit_header(FILE *out, const char *schema, const char *name,
+                       const struct field *f, size_t n)
+{
+    char guard[256];
+    size_t i;
+
+    for (i = 0; name[i] && i < sizeof(guard) - 3; i++)
+        guard[i] = (char)toupper((unsigned char)name[i]);
+    strcpy(guard + i, "_H");
+
+    fprintf(out, "/* Generated by inibind from %s; do not edit. */\n", schema);
+    fprintf(out, "#ifndef %s\n#define %s\n\n", guard, guard);
+    fprintf(out, "#include <stdint.h>\n#include \"iniparser.h\"\n\n");
+    fprintf(out, "struct %s {\n", name);
+    for (i = 0; i < n; i++)
+        fprintf(out, "    %s%s%s;\n", f[i].type->ctype,
+                f[i].type->type == INIPARSER_TYPE_STRING ? "" : " ", f[i].name);
+    fprintf(out, "};\n\n");
+    fprintf(out, "int %s_bind(const struct dictionary *d, struct %s *cfg);\n\n", name, name);
+    fprintf(out, "#endif\n");
+    return 0;
+}
+
+static int emit_source(FILE *out, const char *schema, const char *name,
+                       const char *header, const struct field *f, size_t n)
+{
+    const char *base = strrchr(header, '/');
+
+    fprintf(out, "/* Generated by inibind from %s; do not edit. */\n", schema);
+    fprintf(out, "#include <stddef.h>\n#include \"%s\"\n\n", base ? base + 1 : header);
+    fprintf(out, "static const struct iniparser_binding %s_fields[] = {\n", name);
+    for (size_t i = 0; i < n; i++) {
+        fprintf(out, "    { ");
+        put_string(out, f[i].key);
+        fprintf(out, ", %s, offsetof(struct %s, %s), ", f[i].type->tag, name, f[i].name);
+        if (f[i].def)
+            put_string(out, f[i].def);
+        else
+            fprintf(out, "NULL");
+        fprintf(out, " },\n");
+    }
+    fprintf(out, "};\n\n");
+    fprintf(out, "int %s_bind(const struct dictionary *d, struct %s *cfg)\n{\n", name, name);
+    fprintf(out, "    return iniparser_bind(d, %s_fields,\n", name);
+    fprintf(out, "                          sizeof(%s_fields) / sizeof(%s_fields[0]), cfg);\n",
+            name, name);
+    fprintf(out, "}\n");
+    return 0;
+}
+
+static int write_file(const char *path, const char *schema, const char *name,
+                      const char *header, const struct field *f, size_t n, int source)
+{
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "inibind: cannot open %s\n", path);
+        return -1;
+    }
+    if (source)
+        emit_source(out, schema, name, header, f, n);
+    else
+        emit_header(out, schema, name, f, n);
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 5) {
+        fprintf(stderr, "usage: %s <schema.ini> <name> <output.h> <output.c>\n", argv[0]);
+        return 2;
+    }
+    const char *schema = argv[1];
+    const char *name = argv[2];
+    if (!is_ident(name)) {
+        fprintf(stderr, "inibind: %s is not a C identifier\n", name);
+        return 2;
+    }
+
+    struct dictionary *d = iniparser_load(schema);
+    if (!d)
+        return 1;
+
+    struct field *f = calloc(d->numOfElements ? d->numOfElements : 1, sizeof(*f));
+    char **specs = calloc(d->numOfElements ? d->numOfElements : 1, sizeof(*specs));
+    size_t n = 0;
+    int ret = f && specs ? 0 : 1;
+
+    struct dictionary_iter it;
+    const char *key;
+    const char *val;
+    dictionary_iter_init(&it, d);
+    while (ret == 0 && dictionary_iter_next(&it, &key, &val)) {
+        if (!strchr(key, ':'))
+            continue;               /* section */
+        f[n].key = key;
+        specs[n] = strdup(val ? val : "");
+        if (!specs[n] || parse_spec(&f[n], specs[n]) != 0)
+            ret = 1;
+        n++;
+    }
+    if (ret == 0)
+        qsort(f, n, sizeof(*f), by_key);
+
+    for (size_t i = 0; ret == 0 && i < n; i++) {
+        char *p = f[i].name;
+        if (isdigit((unsigned char)f[i].key[0]))
+            *p++ = '_';
+        for (const char *k = f[i].key; *k && p < f[i].name + sizeof(f[i].name) - 1; k++)
+            *p++ = isalnum((unsigned char)*k) ? *k : '_';
+        *p = '\0';
+        for (size_t j = 0; j < i; j++) {
+            if (strcmp(f[i].name, f[j].name) == 0) {
+                fprintf(stderr, "inibind: %s and %s both map to field %s\n",
+                        f[j].key, f[i].key, f[i].name);
+                ret = 1;
+            }
+        }
+    }
+
+    if (ret == 0 &&
+        (write_file(argv[3], schema, name, argv[3], f, n, 0) != 0 ||
+         write_file(argv[4], schema, name, argv[3], f, n, 1) != 0))
+        ret = 1;
+
+    for (size_t i = 0; i < n; i++)
+        free(specs[i]);
+    free(specs);
+    free(f);
+    iniparser_freedict(d);
+    return ret;
+}
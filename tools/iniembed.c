@@ -0,0 +1,103 @@
+/*
+ * iniembed - compile an .ini file into a C source file.
+ *
+ *   iniembed defaults.ini default_config defaults.c
+ *
+ * The output holds the parsed file as a dictionary image (the format of
+ * dictionary_save_binary()) in a const array, indexed by a perfect hash
+ * that gives each key a bucket of its own, and defines
+ *
+ *   const struct dictionary default_config;
+ *
+ * a read-only dictionary over it. Declare it where it is used with
+ *
+ *   extern const struct dictionary default_config;
+ *
+ * and pass &default_config to the iniparser accessors: there is nothing to
+ * parse or allocate at run time and the data stays in read-only memory.
+ * The image is only valid on targets with the byte order of the host that
+ * ran iniembed.
+ *
+ * Build from the repository root:
+ *   cc -I. -o iniembed tools/iniembed.c iniparser.c dictionary.c dictionary_image.c \
+ *      dictionary_watch.c -lpthread -lrt
+ */
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "iniparser.h"
+#include "dictionary_image.h"
+
+static int is_ident(const char *s)
+{
+    if (!isalpha((unsigned char)*s) && *s != '_')
+        return 0;
+    for (; *s; s++)
+        if (!isalnum((unsigned char)*s) && *s != '_')
+            return 0;
+    return 1;
+}
+
+static int emit(FILE *out, const char *src, const char *name,
+                const unsigned char *img, size_t len)
+{
+    const struct dict_image_header *h = (const struct dict_image_header *)img;
+    uint32_t probe = DICT_IMAGE_BYTEORDER;
+    int little = *(const unsigned char *)&probe == 0x04;
+
+    fprintf(out, "/* Generated by iniembed from %s; do not edit. */\n", src);
+    fprintf(out, "#include \"dictionary_image.h\"\n\n");
+    fprintf(out, "#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != %s\n",
+            little ? "__ORDER_LITTLE_ENDIAN__" : "__ORDER_BIG_ENDIAN__");
+    fprintf(out, "#error \"%s was generated for a %s-endian target\"\n", name,
+            little ? "little" : "big");
+    fprintf(out, "#endif\n\n");
+    fprintf(out, "/* %u keys in %u buckets, %u seed groups */\n", h->nentries,
+            h->nbuckets, h->ngroups);
+    fprintf(out, "static const union {\n");
+    fprintf(out, "    struct dict_image_header header;\n");
+    fprintf(out, "    unsigned char bytes[%zu];\n", len);
+    fprintf(out, "} %s_image = { .bytes = {", name);
+    for (size_t i = 0; i < len; i++)
+        fprintf(out, "%s0x%02x,", i % 12 ? " " : "\n    ", img[i]);
+    fprintf(out, "\n} };\n\n");
+    fprintf(out, "const struct dictionary %s =\n", name);
+    fprintf(out, "    DICT_IMAGE_STATIC(&%s_image.header, %u, %u);\n", name,
+            h->nbuckets, h->nentries);
+    return ferror(out) ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s <input.ini> <name> <output.c>\n", argv[0]);
+        return 2;
+    }
+    if (!is_ident(argv[2])) {
+        fprintf(stderr, "iniembed: %s is not a C identifier\n", argv[2]);
+        return 2;
+    }
+
+    struct dictionary *d = iniparser_load(argv[1]);
+    if (!d)
+        return 1;
+
+    size_t len;
+    unsigned char *img = dict_image_build_perfect(d, &len);
+    iniparser_freedict(d);
+    if (!img)
+        return 1;
+
+    int ret = -1;
+    FILE *out = fopen(argv[3], "w");
+    if (!out) {
+        fprintf(stderr, "iniembed: cannot open %s\n", argv[3]);
+    } else {
+        ret = emit(out, argv[1], argv[2], img, len);
+        if (fclose(out) != 0)
+            ret = -1;
+    }
+    free(img);
+    return ret == 0 ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+/*
+ * inisnap - convert between .ini files and binary dictionary snapshots.
+ *
+ *   inisnap ini2snap config.ini config.snap
+ *   inisnap snap2ini config.snap config.ini
+ *
+ * Build from the repository root:
+ *   cc -I. -o inisnap tools/inisnap.c iniparser.c dictionary.c dictionary_image.c \
+ *      dictionary_watch.c -lpthread -lrt
+ */
+#include <stdio.h>
+#include <string.h>
+#include "iniparser.h"
+
+static int ini2snap(const char *src, const char *dst)
+{
+    struct dictionary *d = iniparser_load(src);
+    if (!d)
+        return 1;
+
+    FILE *out = fopen(dst, "wb");
+    if (!out) {
+        fprintf(stderr, "inisnap: cannot open %s\n", dst);
+        iniparser_freedict(d);
+        return 1;
+    }
+    int ret = dictionary_save_binary(d, out);
+    if (fclose(out) != 0)
+        ret = -1;
+    iniparser_freedict(d);
+    return ret == 0 ? 0 : 1;
+}
+
+static int snap2ini(const char *src, const char *dst)
+{
+    FILE *in = fopen(src, "rb");
+    if (!in) {
+        fprintf(stderr, "inisnap: cannot open %s\n", src);
+        return 1;
+    }
+    struct dictionary *d = dictionary_load_binary(in);
+    fclose(in);
+    if (!d)
+        return 1;
+
+    FILE *out = fopen(dst, "w");
+    if (!out) {
+        fprintf(stderr, "inisnap: cannot open %s\n", dst);
+        iniparser_freedict(d);
+        return 1;
+    }
+    iniparser_dump_ini(d, out);
+    int ret = fclose(out) == 0 ? 0 : 1;
+    iniparser_freedict(d);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 4 && strcmp(argv[1], "ini2snap") == 0)
+        return ini2snap(argv[2], argv[3]);
+    if (argc == 4 && strcmp(argv[1], "snap2ini") == 0)
+        return snap2ini(argv[2], argv[3]);
+
+    fprintf(stderr, "usage: %s ini2snap|snap2ini <input> <output>\n", argv[0]);
+    return 2;
+}